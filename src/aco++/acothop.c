@@ -65,6 +65,16 @@
 #include "thop.h"
 #include "timer.h"
 #include "ls.h"
+#include "threads.h"
+
+static struct rng_stream *ant_stream;  /* random number streams of the ants in the step-major construction */
+
+static long int ls_order[MAX_ANTS];    /* ants that undergo local search in this iteration */
+static long int ls_gain[MAX_ANTS];     /* improvement of the fitness of each ant by the local search */
+static double   ls_seconds[MAX_ANTS];  /* CPU time of the local search of each ant */
+static double   ls_budget;             /* CPU time of the local search per iteration, < 0: not measured yet */
+static double   ls_rate;               /* average improvement per ms of the local search */
+static double   ls_seconds_per_ant;    /* average CPU time of the local search of an ant */
 
 long int termination_condition( void )
 /*    
@@ -74,26 +84,77 @@ long int termination_condition( void )
       (SIDE)EFFECTS:  none
  */
 {
-    return ( ((n_tours >= max_tours) && (elapsed_time( VIRTUAL ) >= max_time)) ||
+    return ( ((n_tours >= max_tours) && (elapsed_time( timer_type ) >= max_time)) ||
             (best_so_far_ant->fitness <= optimal));
 }
 
+void construct_ant( long int k )
+/*    
+      FUNCTION:       construct the solution of ant k from scratch
+      INPUT:          index of the ant
+      OUTPUT:         none
+      (SIDE)EFFECTS:  ant k has constructed a tour and its packing plan
+      COMMENTS:       ant-major construction: the tour is built to completion, so the 
+                      ant's data stays in cache. Uses only thread-local data besides ant k, 
+                      hence ants may be constructed in parallel; not to be used with ACS. 
+                      The random numbers come from the stream of ant k in this iteration
+ */
+{
+    long int step;
+    ant_struct *a = &ant[k];
+
+    rng_init_stream( &rng, n_try, iteration, k );
+    ant_empty_memory( a );
+
+    a->tour_size = 1;
+    a->tour[0] = 0;
+    mark_visited( a, 0 );
+    mark_visited( a, instance.n - 1 );
+
+    step = 0;
+    while ( step < instance.n - 2 && a->tour[a->tour_size - 1] != instance.n - 2 ) {
+        step++;
+        neighbour_choose_and_move_to_next( a, step );
+        a->tour_size++;
+    }
+
+    a->tour[a->tour_size++] = instance.n - 1;
+    a->tour[a->tour_size++] = a->tour[0];
+    a->fitness = compute_fitness( a->tour, a->tour_size, a->packing_plan, packing_ws );
+}
+
 void construct_solutions( void )
 /*    
       FUNCTION:       manage the solution construction phase
       INPUT:          none
       OUTPUT:         none
       (SIDE)EFFECTS:  when finished, all ants of the colony have constructed a solution  
+      COMMENTS:       by default the ants are constructed one after the other, in parallel 
+                      if there is more than one thread; with step_major_flag, which ACS 
+                      requires for its local pheromone update, all ants move one step at 
+                      a time. Each ant draws from its own stream, so both give the same 
+                      tours unless the pheromones change during the construction
  */
 {
 
-    long int i, k;        /* counter variable */
+    long int k;        /* counter variable */
     long int step;    /* counter of the number of construction steps */
+    double   start_time;
     
     TRACE ( printf("construct solutions for all ants\n"); );
 
+    start_time = elapsed_time( timer_type );
+
+    if ( !step_major_flag ) {
+        parallel_for( n_ants, construct_ant );
+        n_tours += n_ants;
+        construction_time += elapsed_time( timer_type ) - start_time;
+        return;
+    }
+
     /* Mark all cities as unvisited */
     for ( k = 0 ; k < n_ants ; k++) {
+        rng_init_stream( &ant_stream[k], n_try, iteration, k );
         ant_empty_memory( &ant[k] );
     }
 
@@ -101,8 +162,8 @@ void construct_solutions( void )
     for ( k = 0 ; k < n_ants ; k++ ) {
         ant[k].tour_size = 1;
         ant[k].tour[0] = 0;
-        ant[k].visited[0] = TRUE;
-        ant[k].visited[instance.n - 1] = TRUE;
+        mark_visited( &ant[k], 0 );
+        mark_visited( &ant[k], instance.n - 1 );
     }
 
     step = 0;
@@ -112,7 +173,9 @@ void construct_solutions( void )
             if ( ant[k].tour[ant[k].tour_size - 1] == instance.n - 2 ) { /* previous city is the last one */
                 continue;
             }
+            rng = ant_stream[k];
             neighbour_choose_and_move_to_next( &ant[k], step);  
+            ant_stream[k] = rng;
             if ( acs_flag )
                 local_acs_pheromone_update( &ant[k], step );
             ant[k].tour_size++;
@@ -122,51 +185,217 @@ void construct_solutions( void )
     for ( k = 0 ; k < n_ants ; k++ ) {
         ant[k].tour[ant[k].tour_size++] = instance.n - 1;
         ant[k].tour[ant[k].tour_size++] = ant[k].tour[0];
-        for( i = ant[k].tour_size; i < instance.n; i++ ) ant[k].tour[i] = 0;
-        ant[k].fitness = compute_fitness( ant[k].tour, ant[k].visited, ant[k].tour_size, ant[k].packing_plan );
+        rng = ant_stream[k];
+        ant[k].fitness = compute_fitness( ant[k].tour, ant[k].tour_size, ant[k].packing_plan, packing_ws );
         if ( acs_flag )
             local_acs_pheromone_update( &ant[k], ant[k].tour_size - 1);
     }
     n_tours += n_ants;
+    construction_time += elapsed_time( timer_type ) - start_time;
 }
 
-void local_search( void )
+void local_search_ant( long int k )
 /*    
-      FUNCTION:       manage the local search phase; apply local search to ALL ants; in 
-                      dependence of ls_flag one of 2-opt, 2.5-opt, and 3-opt local search
-                      is chosen.
-      INPUT:          none
+      FUNCTION:       apply the local search chosen by ls_flag to ant k
+      INPUT:          index of the ant
       OUTPUT:         none
-      (SIDE)EFFECTS:  all ants of the colony have locally optimal tours
-      COMMENTS:       typically, best performance is obtained by applying local search 
-                      to all ants. It is known that some improvements (e.g. convergence 
-                      speed towards high quality solutions) may be obtained for some 
-                      ACO algorithms by applying local search to only some of the ants.
-                      Overall best performance is typcially obtained by using 3-opt.
+      (SIDE)EFFECTS:  ant k has a locally optimal tour and a new packing plan, unless 
+                      they are worse than the ones it constructed; the improvement and the 
+                      CPU time of the search are recorded in ls_gain and ls_seconds
+      COMMENTS:       ants may be processed in parallel; nothing is done once the 
+                      termination condition is met. The random numbers come from the 
+                      local search stream of ant k in this iteration. The search works on 
+                      prev_ls_ant[k], which is exchanged with ant k by swapping pointers if 
+                      it is not worse, so only the tour (and for the packing-aware local 
+                      search the packing plan) is copied
  */
 {
-    long int k;
+    ant_struct *a = &prev_ls_ant[k];
+    int        *help_tour;
+    char       *help_plan;
+    double     start;
+    long int   i;
+
+    ls_gain[k] = 0;
+    ls_seconds[k] = 0.;
+    if (termination_condition()) return;
+
+    start = thread_time();
+    rng_init_stream( &rng, n_try, iteration, n_ants + k );
+
+    a->tour_size = ant[k].tour_size;
+    for ( i = 0 ; i < a->tour_size ; i++ )
+        a->tour[i] = ant[k].tour[i];
+
+    switch (ls_flag) {
+    case 1:
+        two_opt_first( a->tour, a->tour_size );    /* 2-opt local search */
+        break;
+    case 2:
+        two_h_opt_first( a->tour, a->tour_size );  /* 2.5-opt local search */
+        break;
+    case 3:
+        three_opt_first( a->tour, a->tour_size );  /* 3-opt local search */
+        break;
+    case 4:
+        or_opt_first( a->tour, a->tour_size );     /* 2-opt and Or-opt local search */
+        break;
+    case 5:
+        /* packing-aware local search, keeps its own packing plan */
+        for ( i = 0 ; i < instance.m ; i++ )
+            a->packing_plan[i] = ant[k].packing_plan[i];
+        a->fitness = packing_opt_first( a->tour, &a->tour_size, a->packing_plan );
+        break;
+    default:
+        fprintf(stderr,"type of local search procedure not correctly specified\n");
+        exit(1);
+    }
+    if ( ls_flag != 5 )
+        a->fitness = compute_fitness( a->tour, a->tour_size, a->packing_plan, packing_ws ); 
+
+    if ( a->fitness <= ant[k].fitness ) {
+        ls_gain[k] = ant[k].fitness - a->fitness;
+        help_tour = ant[k].tour;
+        help_plan = ant[k].packing_plan;
+        ant[k].tour = a->tour;
+        ant[k].packing_plan = a->packing_plan;
+        ant[k].tour_size = a->tour_size;
+        ant[k].fitness = a->fitness;
+        a->tour = help_tour;
+        a->packing_plan = help_plan;
+    }
+    ls_seconds[k] = thread_time() - start;
+}
 
-    TRACE ( printf("apply local search to all ants\n"); );
+static void local_search_task( long int i )
+/*    
+      FUNCTION:       apply the local search to the i-th chosen ant
+      INPUT:          index into ls_order
+      OUTPUT:         none
+ */
+{
+    local_search_ant( ls_order[i] );
+}
+
+static long int select_ls_ants( void )
+/*    
+      FUNCTION:       choose the ants that undergo local search in this iteration
+      INPUT:          none
+      OUTPUT:         number of chosen ants, whose indices are stored in ls_order
+      COMMENTS:       without ls_ants, ls_diff and ls_budget_flag all ants are chosen. 
+                      Otherwise the ants are ranked by fitness, best first, and the ls_ants 
+                      best ones and those with more than ls_diff arcs that are not in the 
+                      restart-best tour (all, as long as there is none) are chosen; with 
+                      neither of the two, all ants. With ls_budget_flag, only as many of 
+                      the best chosen ants are kept as the budget allows
+ */
+{
+    long int i, k, n;
+    long int fitness[MAX_ANTS], rank[MAX_ANTS];
 
+    if ( ls_ants == 0 && ls_diff < 0 && !ls_budget_flag ) {
+        for ( k = 0 ; k < n_ants ; k++ )
+            ls_order[k] = k;
+        return n_ants;
+    }
     for ( k = 0 ; k < n_ants ; k++ ) {
-        switch (ls_flag) {
-        case 1:
-            two_opt_first( ant[k].tour, ant[k].tour_size );    /* 2-opt local search */
-            break;
-        case 2:
-            two_h_opt_first( ant[k].tour, ant[k].tour_size );  /* 2.5-opt local search */
-            break;
-        case 3:
-            three_opt_first( ant[k].tour, ant[k].tour_size );  /* 3-opt local search */
-            break;
-        default:
-            fprintf(stderr,"type of local search procedure not correctly specified\n");
-            exit(1);
+        fitness[k] = ant[k].fitness;
+        rank[k] = k;
+    }
+    sort2( fitness, rank, 0, n_ants - 1 );
+    n = 0;
+    for ( i = 0 ; i < n_ants ; i++ ) {
+        k = rank[i];
+        if ( ( ls_ants == 0 && ls_diff < 0 ) || i < ls_ants ||
+             ( ls_diff >= 0 && ( restart_best_ant->fitness == INFTY ||
+                                 distance_between_ants( &ant[k], restart_best_ant ) > ls_diff ) ) )
+            ls_order[n++] = k;
+    }
+    if ( ls_budget_flag && ls_budget >= 0. )
+        n = MIN( n, MAX( 1, (long int) ( ls_budget / ls_seconds_per_ant ) ) );
+    return n;
+}
+
+static void adapt_ls_budget( long int n )
+/*    
+      FUNCTION:       adapt the CPU time of the local search per iteration
+      INPUT:          number of ants in ls_order that underwent local search
+      OUTPUT:         none
+      (SIDE)EFFECTS:  ls_budget, ls_rate and ls_seconds_per_ant are updated
+      COMMENTS:       the first measurement sets the budget. Then it grows by a quarter 
+                      while the last quarter of the searched ants, those with the worst 
+                      constructed solutions, still improve per ms at least half as much as 
+                      the local search on average, and shrinks by a fifth otherwise. It 
+                      stays between the time of one and of n_ants local searches
+ */
+{
+    long int i, k, tail = MAX( 1, n / 4 );
+    double   seconds = 0., gain = 0., tail_seconds = 0., tail_gain = 0., rate, tail_rate;
+
+    for ( i = 0 ; i < n ; i++ ) {
+        k = ls_order[i];
+        seconds += ls_seconds[k];
+        gain += ls_gain[k];
+        if ( i >= n - tail ) {
+            tail_seconds += ls_seconds[k];
+            tail_gain += ls_gain[k];
         }
-        ant[k].fitness = compute_fitness( ant[k].tour, ant[k].visited, ant[k].tour_size, ant[k].packing_plan ); 
-        if (termination_condition()) return;
     }
+    if ( seconds <= 0. || tail_seconds <= 0. )
+        return;  /* interrupted by the termination condition */
+    rate = gain / ( 1000. * seconds );
+    tail_rate = tail_gain / ( 1000. * tail_seconds );
+    if ( ls_budget < 0. ) {
+        ls_budget = seconds;
+        ls_rate = rate;
+        ls_seconds_per_ant = seconds / n;
+    }
+    else {
+        ls_rate = 0.9 * ls_rate + 0.1 * rate;
+        ls_seconds_per_ant = 0.9 * ls_seconds_per_ant + 0.1 * seconds / n;
+    }
+    if ( tail_rate > 0. && tail_rate >= 0.5 * ls_rate )
+        ls_budget *= 1.25;
+    else
+        ls_budget *= 0.8;
+    ls_budget = MIN( MAX( ls_budget, ls_seconds_per_ant ), n_ants * ls_seconds_per_ant );
+}
+
+void local_search( void )
+/*    
+      FUNCTION:       manage the local search phase; apply local search to the chosen 
+                      ants; in dependence of ls_flag one of 2-opt, 2.5-opt, 3-opt, Or-opt 
+                      and the packing-aware local search is chosen.
+      INPUT:          none
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the chosen ants of the colony have locally optimal tours
+      COMMENTS:       the ants are processed in parallel if there is more than one thread;
+                      by default, local search is applied to all ants. With ls_ants and 
+                      ls_diff it is only applied to the best ants and to those that differ 
+                      from the restart-best ant, and with ls_budget_flag the number of 
+                      ants is adapted to the improvement per ms (see adapt_ls_budget).
+                      Overall best performance is typcially obtained by using 3-opt.
+                      With dlb_seed_flag, the don't look bits are seeded from the 
+                      restart-best tour, once there is one
+ */
+{
+    long int n, i;
+    double   start_time;
+
+    TRACE ( printf("apply local search\n"); );
+
+    start_time = elapsed_time( timer_type );
+    n = select_ls_ants();
+    if ( dlb_seed_flag && restart_best_ant->fitness < INFTY )
+        set_ls_reference( restart_best_ant->tour, restart_best_ant->tour_size );
+    parallel_for( n, local_search_task );
+    set_ls_reference( NULL, 0 );
+    if ( ls_budget_flag )
+        adapt_ls_budget( n );
+    for ( i = 0 ; i < n ; i++ )
+        if ( ls_seconds[ls_order[i]] > 0. )
+            n_ls_ants++;
+    ls_time += elapsed_time( timer_type ) - start_time;
 }
 
 void update_statistics( void )
@@ -188,7 +417,7 @@ void update_statistics( void )
 
     if ( ant[iteration_best_ant].fitness < best_so_far_ant->fitness ) {
         
-        time_used = elapsed_time( VIRTUAL ); /* best sol found after time_used */
+        time_used = elapsed_time( timer_type ); /* best sol found after time_used */
         copy_from_to( &ant[iteration_best_ant], best_so_far_ant );
 
         found_best = iteration;
@@ -233,7 +462,7 @@ void search_control_and_statistics( void )
     if (!(iteration % 100)) {
         population_statistics();
         branching_factor = node_branching(lambda);
-        /*printf("\nbest so far %ld, iteration: %ld, time %.2f, b_fac %.5f\n",best_so_far_ant->fitness,iteration,elapsed_time( VIRTUAL),branching_factor);*/
+        /*printf("\nbest so far %ld, iteration: %ld, time %.2f, b_fac %.5f\n",best_so_far_ant->fitness,iteration,elapsed_time( timer_type ),branching_factor);*/
         if ( mmas_flag && (branching_factor < branch_fac) && (iteration - restart_found_best > 250) ) {
             /* MAX-MIN Ant System was the first ACO algorithm to use
                pheromone trail re-initialisation as implemented
@@ -243,7 +472,7 @@ void search_control_and_statistics( void )
             init_pheromone_trails( trail_max );
             compute_total_information();
             restart_iteration = iteration;
-            restart_time = elapsed_time( VIRTUAL );
+            restart_time = elapsed_time( timer_type );
         }
         /*printf("try %li, iteration %li, b-fac %f \n\n", n_try,iteration,branching_factor);*/
     }
@@ -385,7 +614,7 @@ void bwas_update( void )
         restart_best_ant->fitness = INFTY;
         init_pheromone_trails( trail_0 );
         restart_iteration = iteration;
-        restart_time = elapsed_time( VIRTUAL );
+        restart_time = elapsed_time( timer_type );
         /*printf("init pheromone trails with %.15f, iteration %ld\n",trail_0,iteration);*/
     }
     else
@@ -409,6 +638,20 @@ void acs_global_update( void )
     global_acs_pheromone_update( best_so_far_ant );
 }
 
+void paco_update( void )
+/*    
+      FUNCTION:       manage the archive update of population-based ACO
+      INPUT:          none
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the iteration-best ant enters the archive, the oldest archive tour 
+                      leaves it
+ */
+{
+    TRACE ( printf("Population-based ACO archive update\n"); );
+
+    paco_archive_update( &ant[find_best()] );
+}
+
 void pheromone_trail_update( void )  
 /*    
       FUNCTION:       manage global pheromone trail update for the ACO algorithms
@@ -419,8 +662,11 @@ void pheromone_trail_update( void )
  */
 {
     /* Simulate the pheromone evaporation of all pheromones; this is not necessary
-       for ACS (see also ACO Book) */
-    if ( as_flag || eas_flag || ras_flag || bwas_flag || mmas_flag ) {
+       for ACS (see also ACO Book) and P-ACO */
+    if ( incremental_flag ) {
+        /* only shrink the scale of all trails, see incremental_evaporation */
+        incremental_evaporation();
+    } else if ( as_flag || eas_flag || ras_flag || bwas_flag || mmas_flag ) {
         if ( ls_flag ) {
             if ( mmas_flag )
                 mmas_evaporation_nn_list();
@@ -449,17 +695,22 @@ void pheromone_trail_update( void )
         bwas_update();
     else if ( acs_flag )
         acs_global_update();
+    else if ( paco_flag )
+        paco_update();
 
     /* check pheromone trail limits for MMAS; not necessary if local
      search is used, because in the local search case lower pheromone trail
      limits are checked in procedure mmas_evaporation_nn_list */
-    if ( mmas_flag && !ls_flag )
+    if ( mmas_flag && !ls_flag && !incremental_flag )
         check_pheromone_trail_limits();
 
     /* Compute combined information pheromone times heuristic info after
-     the pheromone update for all ACO algorithms except ACS; in the ACS case 
-     this is already done in the pheromone update procedures of ACS */
-    if ( as_flag || eas_flag || ras_flag || mmas_flag || bwas_flag ) {
+     the pheromone update for all ACO algorithms except ACS and P-ACO; in their 
+     case this is already done in their pheromone update procedures; in the 
+     incremental mode it is done for the arcs that received pheromone */
+    if ( incremental_flag ) {
+        incremental_total_information();
+    } else if ( as_flag || eas_flag || ras_flag || mmas_flag || bwas_flag ) {
         if ( ls_flag ) {
             compute_nn_list_total_information();
         } else {
@@ -479,37 +730,51 @@ int main(int argc, char *argv[]) {
       COMMENTS:       this function controls the run of "max_tries" independent trials
      */
 
-    long int i, k;
+    long int i;
+    double   nn_start;
 
     start_timers();
 
     init_program(argc, argv);
     
+    nn_start = elapsed_time( REAL );
     instance.nn_list = compute_nn_lists();
-    pheromone = generate_double_matrix( instance.n, instance.n );
-    total = generate_double_matrix( instance.n, instance.n );
+    if (log_file) fprintf(log_file,"nearest neighbour lists of %li cities computed in %.3f seconds \n", 
+                          instance.n, elapsed_time( REAL ) - nn_start);
+    if ( sparse_flag ) {
+        allocate_sparse_pheromone();
+    } else {
+        pheromone = generate_double_matrix( instance.n, instance.n );
+        eta_beta = generate_double_matrix( instance.n, instance.n );
+        if ( lazy_flag )
+            allocate_lazy_pheromone();   /* the total information is only kept in total_nn */
+        else
+            total = generate_double_matrix( instance.n, instance.n );
+    }
+    total_nn = generate_double_matrix( instance.n, nn_ants );
+    eta_nn = generate_double_matrix( instance.n, nn_ants );
+    compute_heuristic_information();
+    if ( (ant_stream = (struct rng_stream *) malloc( n_ants * sizeof(struct rng_stream) )) == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
 
-    time_used = elapsed_time( VIRTUAL );
+    time_used = elapsed_time( timer_type );
     /*printf("Initialization took %.10f seconds\n",time_used);*/
         
     for ( n_try = 0 ; n_try < max_tries ; n_try++ ) {
         init_try(n_try);
+        ls_budget = -1.;  /* the local search time is measured anew in each try */
         while ( !termination_condition() ) {
             construct_solutions();            
             if ( ls_flag > 0 ) {
-                for ( k = 0 ; k < n_ants ; k++ ) {
-                    copy_from_to( &ant[k], &prev_ls_ant[k] );
-                }
                 local_search();
-                for ( k = 0 ; k < n_ants ; k++ ) {                
-                    if (ant[k].fitness > prev_ls_ant[k].fitness ) {
-                        copy_from_to( &prev_ls_ant[k], &ant[k] );
-                    }
-                }                
             }
             update_statistics();
             pheromone_trail_update();
             search_control_and_statistics();
+            if ( iteration == 1 )
+                first_iteration_allocations = workspace_allocations;
             iteration++;
         }
         exit_try(n_try);
@@ -517,9 +782,24 @@ int main(int argc, char *argv[]) {
     exit_program();
 
     free( instance.distance );
+    free( instance.compact_distance );
     free( instance.nn_list );
+    free( instance.log_profit );
+    free( instance.log_weight );
+    free( instance.city_item_start );
+    free( instance.city_items );
     free( pheromone );
     free( total );
+    free( total_nn );
+    free( eta_beta );
+    free( eta_nn );
+    if ( sparse_flag )
+        free_sparse_pheromone();
+    if ( lazy_flag )
+        free_lazy_pheromone();
+    if ( paco_flag )
+        free_paco_archive();
+    free( ant_stream );
     free( best_in_try );
     free( best_found_at );
     free( time_best_found );
@@ -534,24 +814,28 @@ int main(int argc, char *argv[]) {
     
     for ( i = 0 ; i < n_ants ; i++ ) {
         free( prev_ls_ant[i].tour );
-        free( prev_ls_ant[i].visited );
         free( prev_ls_ant[i].packing_plan );
     }
     free( prev_ls_ant );
     
     free( best_so_far_ant->tour );
-    free( best_so_far_ant->visited );
     free( best_so_far_ant->packing_plan ); 
     
     free( restart_best_ant->tour );
-    free( restart_best_ant->visited );
     free( restart_best_ant->packing_plan ); 
     
     free( global_best_ant->tour );
-    free( global_best_ant->visited );
     free( global_best_ant->packing_plan ); 
     
     free( prob_of_selection );
+    free_tour_index();
+    free_packing_workspace( packing_ws );
+    free_packing_cache();
+    free_distance_cache();
+    free_ls_workspace( ls_ws );
+    if ( dlb_seed_flag )
+        free_ls_reference();
+    stop_thread_pool();
         
     return 0;
 }
@@ -73,8 +73,62 @@ ant_struct *global_best_ant;
 
 double   **pheromone;
 double   **total;
-
-double   *prob_of_selection;
+double   **total_nn;
+
+double   **eta_beta;
+double   **eta_nn;
+
+double   pow_ulps;             /* error budget of tau^alpha in ulps, 0: exact pow */
+struct pow_table alpha_pow;    /* tables for tau^alpha */
+
+long int incremental_flag;     /* update total only on arcs whose pheromone changed */
+double   pheromone_scale;      /* incremental mode: a trail is pheromone_scale * pheromone[i][j] */
+double   pheromone_floor;      /* incremental mode: trail_min / pheromone_scale for MMAS, else 0 */
+double   total_floor;          /* incremental mode: pheromone_floor^alpha */
+
+static double   floor_trail_min;       /* trail limits and scale in effect at the last update */
+static double   floor_trail_max;
+static double   floor_scale;
+static double   deposit_floor;         /* lower limit of a trail before a deposit */
+static double   deposit_ceiling;       /* upper limit of a trail after a deposit */
+static long int total_outdated;        /* = 1, total has to be recomputed from scratch */
+
+long int lazy_flag;            /* evaporate the trail of an arc when it is read */
+static int      **pheromone_stamp;     /* lazy mode: evaporations up to the last update of each trail */
+static long int pheromone_epoch;       /* lazy mode: evaporations since the trails were initialized */
+static double   *decay_power;          /* lazy mode: (1 - rho)^d for d < LAZY_DECAY_STEPS */
+
+long int sparse_flag;          /* store only the trails of candidate list and elite arcs */
+double   **pheromone_nn;       /* sparse mode: trails aligned with nn_list */
+double   pheromone_default;    /* sparse mode: trail of all arcs that are not stored */
+
+static short    **nn_mirror;   /* sparse mode: position of i in the candidate list of nn_list[i][k], or -1 */
+static long int *rev_start;    /* sparse mode: cities that have i in their candidate list, but */
+static int      *rev_city;     /* are not in the one of i, are rev_city[rev_start[i] .. rev_start[i+1]-1] */
+static short    *rev_pos;      /* position of i in the candidate list of rev_city */
+static long int *n_extra;      /* sparse mode: no. of further arcs stored for each city */
+static int      **extra_city;  /* sparse mode: further arcs, stored at both of their cities */
+static double   **extra_trail;
+static double   **extra_eta;
+static double   **extra_total;
+
+static int      *tour_position;        /* position of each city in the tour last passed to index_tour */
+static unsigned int *position_stamp;   /* tour_position[c] is valid iff position_stamp[c] == position_epoch */
+static unsigned int position_epoch;
+
+static double trail_power( double tau );
+static double lazy_trail( long int i, long int j );
+static double lazy_current_trail( long int i, long int j );
+static void lazy_set_trail( long int i, long int j, double tau );
+static void lazy_total_information( void );
+static double sparse_trail( long int i, long int j );
+static void sparse_set_trail( long int i, long int j, double tau );
+static void sparse_scale_trails( double factor, long int nn_only );
+static void sparse_trail_limits( double lower, double upper, long int nn_only );
+static void sparse_total_information( void );
+static void sparse_choose_best_next( ant_struct *a, long int phase );
+
+__thread double *prob_of_selection;
 
 long int n_ants;      /* number of ants */
 long int nn_ants;     /* length of nearest neighbor lists for the ants' solution construction */
@@ -90,6 +144,9 @@ long int ras_flag;    /* rank-based version of ant system */
 long int mmas_flag;   /* MAX-MIN ant system */
 long int bwas_flag;   /* best-worst ant system */
 long int acs_flag;    /* ant colony system */
+long int paco_flag;   /* population-based ACO */
+
+long int step_major_flag; /* move all ants one step at a time */
 
 long int elitist_ants;    /* additional parameter for elitist ant system, no. elitist ants */
 
@@ -101,6 +158,13 @@ long int u_gb;            /* every u_gb iterations update with best-so-far ant *
 
 double   trail_0;         /* initial pheromone level in ACS and BWAS */
 
+long int paco_size;       /* number of tours in the archive of population-based ACO */
+static int      **paco_tour;      /* P-ACO: tours of the archive */
+static long int *paco_tour_size;  /* P-ACO: number of entries of the archive tours */
+static long int paco_count;       /* P-ACO: number of tours in the archive */
+static long int paco_oldest;      /* P-ACO: archive slot of the tour that leaves next */
+static double   paco_delta;       /* P-ACO: trail added by each archive tour that contains an arc */
+
 
 /************************************************************
  ************************************************************
@@ -120,15 +184,42 @@ void init_pheromone_trails( double initial_trail )
     
     TRACE ( printf(" init trails with %.15f\n",initial_trail); );
 
-    /* Initialize pheromone trails */
-    for ( i = 0 ; i < instance.n ; i++ ) {
-        for ( j =0 ; j <= i ; j++ ) {
-            pheromone[i][j] = initial_trail;
-            pheromone[j][i] = initial_trail;
-            total[i][j] = initial_trail;
-            total[j][i] = initial_trail;
+    if ( sparse_flag ) {
+        for ( i = 0 ; i < instance.n ; i++ ) {
+            for ( j = 0 ; j < nn_ants ; j++ ) {
+                pheromone_nn[i][j] = initial_trail;
+                total_nn[i][j] = initial_trail;
+            }
+            n_extra[i] = 0;
+        }
+        pheromone_default = initial_trail;
+    } else if ( lazy_flag ) {
+        for ( i = 0 ; i < instance.n ; i++ ) {
+            for ( j = 0 ; j < instance.n ; j++ ) {
+                pheromone[i][j] = initial_trail;
+                pheromone_stamp[i][j] = 0;
+            }
+        }
+        pheromone_epoch = 0;
+    } else {
+        /* Initialize pheromone trails */
+        for ( i = 0 ; i < instance.n ; i++ ) {
+            for ( j =0 ; j <= i ; j++ ) {
+                pheromone[i][j] = initial_trail;
+                pheromone[j][i] = initial_trail;
+                total[i][j] = initial_trail;
+                total[j][i] = initial_trail;
+            }
         }
+        compute_total_nn_information();
     }
+
+    pheromone_scale = 1.0;
+    floor_scale = 1.0;
+    floor_trail_min = mmas_flag ? trail_min : 0.0;
+    floor_trail_max = mmas_flag ? trail_max : HUGE_VAL;
+    pheromone_floor = incremental_flag ? floor_trail_min : 0.0;
+    total_floor = pheromone_floor > 0.0 ? pow(pheromone_floor, alpha) : 0.0;
 }
 
 void evaporation( void )
@@ -143,6 +234,15 @@ void evaporation( void )
 
     TRACE ( printf("pheromone evaporation\n"); );
 
+    if ( sparse_flag ) {
+        sparse_scale_trails( 1 - rho, FALSE );
+        return;
+    }
+    if ( lazy_flag ) {
+        /* the trails are evaporated when they are read, see lazy_trail */
+        pheromone_epoch++;
+        return;
+    }
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j <= i ; j++ ) {
             pheromone[i][j] = (1 - rho) * pheromone[i][j];
@@ -166,6 +266,10 @@ void evaporation_nn_list( void )
 
     TRACE ( printf("pheromone evaporation nn_list\n"); );
 
+    if ( sparse_flag ) {
+        sparse_scale_trails( 1 - rho, TRUE );
+        return;
+    }
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j < nn_ants ; j++ ) {
             help_city = instance.nn_list[i][j];
@@ -188,9 +292,21 @@ void global_update_pheromone( ant_struct *a )
     TRACE ( printf("global pheromone update\n"); );
 
     d_tau = 1.0 / (double) a->fitness;
-    for ( i = 0 ; i < instance.n ; i++ ) {
+    for ( i = 0 ; i < a->tour_size - 1 ; i++ ) {
         j = a->tour[i];
         h = a->tour[i+1];
+        if ( incremental_flag ) {
+            incremental_deposit( j, h, d_tau );
+            continue;
+        }
+        if ( sparse_flag ) {
+            sparse_set_trail( j, h, sparse_trail( j, h ) + d_tau );
+            continue;
+        }
+        if ( lazy_flag ) {
+            lazy_set_trail( j, h, lazy_current_trail( j, h ) + d_tau );
+            continue;
+        }
         pheromone[j][h] += d_tau;
         pheromone[h][j] = pheromone[j][h];
     }
@@ -210,14 +326,75 @@ void global_update_pheromone_weighted( ant_struct *a, long int weight )
     TRACE ( printf("global pheromone update weighted\n"); );
 
     d_tau = (double) weight / (double) a->fitness;
-    for ( i = 0 ; i < instance.n ; i++ ) {
+    for ( i = 0 ; i < a->tour_size - 1 ; i++ ) {
         j = a->tour[i];
         h = a->tour[i+1];
+        if ( incremental_flag ) {
+            incremental_deposit( j, h, d_tau );
+            continue;
+        }
+        if ( sparse_flag ) {
+            sparse_set_trail( j, h, sparse_trail( j, h ) + d_tau );
+            continue;
+        }
+        if ( lazy_flag ) {
+            lazy_set_trail( j, h, lazy_current_trail( j, h ) + d_tau );
+            continue;
+        }
         pheromone[j][h] += d_tau;
         pheromone[h][j] = pheromone[j][h];
     }
 }
 
+void compute_heuristic_information( void )
+/*    
+      FUNCTION: calculates the heuristic information HEURISTIC^beta of all arcs once per 
+                run, also aligned with the candidate lists
+      INPUT:    none  
+      OUTPUT:   none
+      COMMENTS: beta does not change during a run, so the total information only needs 
+                the trails to the power of alpha, see trail_power
+ */
+{ 
+    long int    i, j;
+
+    TRACE ( printf("compute heuristic information\n"); );
+
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        if ( sparse_flag ) {
+            for ( j = 0 ; j < nn_ants ; j++ ) {
+                eta_nn[i][j] = pow(HEURISTIC(i,instance.nn_list[i][j]),beta);
+            }
+            continue;
+        }
+        for ( j = 0 ; j < instance.n ; j++ ) {
+            eta_beta[i][j] = pow(HEURISTIC(i,j),beta);
+        }
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            eta_nn[i][j] = eta_beta[i][instance.nn_list[i][j]];
+        }
+    }
+
+    alpha_pow.terms = 0;
+    if ( alpha != 1.0 && pow_ulps > 0.0 )
+        init_pow_table( &alpha_pow, alpha, pow_ulps );
+}
+
+static double trail_power( double tau )
+/*    
+      FUNCTION: computes tau^alpha
+      INPUT:    pheromone trail
+      OUTPUT:   tau^alpha
+      COMMENTS: uses table_pow if pow_ulps allows it
+ */
+{ 
+    if ( alpha == 1.0 )
+        return tau;
+    if ( alpha_pow.terms > 0 )
+        return table_pow( &alpha_pow, tau );
+    return pow( tau, alpha );
+}
+
 void compute_total_information( void )
 /*    
       FUNCTION: calculates heuristic info times pheromone for each arc
@@ -229,12 +406,21 @@ void compute_total_information( void )
 
     TRACE ( printf("compute total information\n"); );
 
+    if ( sparse_flag ) {
+        sparse_total_information();
+        return;
+    }
+    if ( lazy_flag ) {
+        lazy_total_information();
+        return;
+    }
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j < i ; j++ ) {
-            total[i][j] = pow(pheromone[i][j],alpha) * pow(HEURISTIC(i,j),beta);
+            total[i][j] = trail_power(pheromone[i][j]) * eta_beta[i][j];
             total[j][i] = total[i][j];
         }
     }
+    compute_total_nn_information();
 }
 
 void compute_nn_list_total_information( void )
@@ -248,16 +434,740 @@ void compute_nn_list_total_information( void )
 
     TRACE ( printf("compute total information nn_list\n"); );
 
+    if ( sparse_flag ) {
+        for ( i = 0 ; i < instance.n ; i++ ) {
+            for ( j = 0 ; j < nn_ants ; j++ ) {
+                h = instance.nn_list[i][j];
+                if ( nn_mirror[i][j] >= 0 && pheromone_nn[i][j] < pheromone_nn[h][nn_mirror[i][j]] )
+                    /* force pheromone trails to be symmetric as much as possible */
+                    pheromone_nn[h][nn_mirror[i][j]] = pheromone_nn[i][j];
+            }
+        }
+        sparse_total_information();
+        return;
+    }
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j < nn_ants ; j++ ) {
             h = instance.nn_list[i][j];
             if ( pheromone[i][h] < pheromone[h][i] )
                 /* force pheromone trails to be symmetric as much as possible */
                 pheromone[h][i] = pheromone[i][h];
-            total[i][h] = pow(pheromone[i][h], alpha) * pow(HEURISTIC(i,h),beta);
+            total[i][h] = trail_power(pheromone[i][h]) * eta_beta[i][h];
             total[h][i] = total[i][h];
         }
     }
+    compute_total_nn_information();
+}
+
+void compute_total_nn_information( void )
+/*    
+      FUNCTION: copies the total information of the arcs in the candidate lists into 
+                total_nn, where row i is aligned with instance.nn_list[i]
+      INPUT:    none  
+      OUTPUT:   none
+      COMMENTS: the solution construction only reads total_nn, so each step scans one 
+                contiguous row instead of gathering from the full matrix
+ */
+{ 
+    long int    i, j;
+
+    if ( sparse_flag || lazy_flag )
+        return;   /* total_nn is the only copy of the total information */
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            total_nn[i][j] = total[i][instance.nn_list[i][j]];
+        }
+    }
+}
+
+static void update_total_nn_entry( long int h, long int j )
+/*    
+      FUNCTION: copies total[h][j] into total_nn if j is in the candidate list of h
+      INPUT:    the two cities of the arc
+      OUTPUT:   none
+ */
+{ 
+    long int    i;
+
+    for ( i = 0 ; i < nn_ants ; i++ ) {
+        if ( instance.nn_list[h][i] == j ) {
+            total_nn[h][i] = total[h][j];
+            return;
+        }
+    }
+}
+
+/****************************************************************
+ ****************************************************************
+Procedures for the incremental update of the total information
+ ****************************************************************
+ ****************************************************************/
+
+/* Evaporation multiplies all trails by the same factor (1 - rho). In the incremental 
+   mode it only shrinks pheromone_scale, and pheromone and total hold the trails and 
+   the total information relative to that scale; the relative order of the total 
+   information within a candidate list, which is all the construction needs, does not 
+   change. Only the arcs that receive pheromone are recomputed. The lower MMAS limit 
+   is applied when the total information is read: an arc is worth at least 
+   total_floor * eta_beta. */
+
+void incremental_evaporation( void )
+/*    
+      FUNCTION: evaporation of all pheromone trails in the incremental mode
+      INPUT:    none  
+      OUTPUT:   none
+      (SIDE)EFFECTS: pheromone_scale is reduced by factor (1 - rho); the limits for the 
+                following deposits are set
+      COMMENTS: the lazy lower MMAS limit is exact as long as trail_min does not decrease;
+                if the limits were lowered, the old ones are first applied to all trails 
+                and total is recomputed after the deposits
+ */
+{ 
+    long int    i, j;
+    double      old_floor;
+
+    TRACE ( printf("incremental pheromone evaporation\n"); );
+
+    old_floor = floor_trail_min / floor_scale;
+    pheromone_scale *= (1 - rho);
+
+    if ( mmas_flag && (trail_min < floor_trail_min || (!ls_flag && trail_max < floor_trail_max)) ) {
+        for ( i = 0 ; i < instance.n ; i++ ) {
+            for ( j = 0 ; j < instance.n ; j++ ) {
+                if ( pheromone[i][j] < old_floor )
+                    pheromone[i][j] = old_floor;
+                if ( !ls_flag && pheromone[i][j] > trail_max / pheromone_scale )
+                    pheromone[i][j] = trail_max / pheromone_scale;
+            }
+        }
+        total_outdated = TRUE;
+    }
+
+    deposit_floor = 0.0;
+    deposit_ceiling = HUGE_VAL;
+    if ( mmas_flag ) {
+        /* with local search the lower limit is applied when evaporating, otherwise both 
+           limits are applied after the deposit (see mmas_evaporation_nn_list and 
+           check_pheromone_trail_limits) */
+        if ( ls_flag ) {
+            deposit_floor = trail_min / pheromone_scale;
+        } else {
+            deposit_floor = old_floor;
+            deposit_ceiling = trail_max / pheromone_scale;
+        }
+    }
+}
+
+void incremental_deposit( long int j, long int h, double d_tau )
+/*    
+      FUNCTION: adds d_tau to the pheromone trail of arc (j,h) in the incremental mode
+      INPUT:    the two cities of the arc and the amount of pheromone
+      OUTPUT:   none
+      (SIDE)EFFECTS: the trail and the total information of the arc are updated in both 
+                directions
+ */
+{ 
+    double      tau = pheromone[j][h];
+
+    if ( tau < deposit_floor )
+        tau = deposit_floor;
+    tau += d_tau / pheromone_scale;
+    if ( tau > deposit_ceiling )
+        tau = deposit_ceiling;
+    if ( mmas_flag && !ls_flag && tau < trail_min / pheromone_scale )
+        tau = trail_min / pheromone_scale;
+    pheromone[j][h] = tau;
+    pheromone[h][j] = tau;
+    total[j][h] = trail_power(tau) * eta_beta[j][h];
+    total[h][j] = total[j][h];
+    update_total_nn_entry( j, h );
+    update_total_nn_entry( h, j );
+}
+
+void incremental_total_information( void )
+/*    
+      FUNCTION: finishes the pheromone update of an iteration in the incremental mode
+      INPUT:    none  
+      OUTPUT:   none
+      (SIDE)EFFECTS: the floor of the total information is set; if pheromone_scale gets 
+                too small, all trails and the total information are rescaled to avoid 
+                an overflow
+ */
+{ 
+    long int    i, j;
+    double      factor;
+
+    if ( pheromone_scale < 1e-100 || pow(pheromone_scale, alpha) < 1e-100 ) {
+        factor = pow(pheromone_scale, alpha);
+        for ( i = 0 ; i < instance.n ; i++ ) {
+            for ( j = 0 ; j < instance.n ; j++ ) {
+                pheromone[i][j] *= pheromone_scale;
+                total[i][j] *= factor;
+            }
+        }
+        pheromone_scale = 1.0;
+        compute_total_nn_information();
+    }
+    if ( total_outdated ) {
+        compute_total_information();
+        total_outdated = FALSE;
+    }
+
+    floor_trail_min = mmas_flag ? trail_min : 0.0;
+    floor_trail_max = mmas_flag ? trail_max : HUGE_VAL;
+    floor_scale = pheromone_scale;
+    pheromone_floor = floor_trail_min / pheromone_scale;
+    total_floor = pheromone_floor > 0.0 ? pow(pheromone_floor, alpha) : 0.0;
+}
+
+/****************************************************************
+ ****************************************************************
+Procedures for the lazy evaporation
+ ****************************************************************
+ ****************************************************************/
+
+/* Without local search every iteration evaporates all n^2 trails, although the ants 
+   mostly read the arcs of the candidate lists. In the lazy mode pheromone[i][j] holds 
+   the trail of arc (i,j) after the update of iteration pheromone_stamp[i][j], that is, 
+   after the evaporation and the deposits but before the MMAS trail limits. A read 
+   applies the limits, the evaporations since then and again the limits; as the trails 
+   only shrink by evaporation, this gives the same trail as the evaporation of the full 
+   matrix as long as trail_min and trail_max do not change. An evaporation only 
+   increments pheromone_epoch, and the total information is only computed for the 
+   arcs of the candidate lists; choose_best_next computes the one of further arcs. */
+
+void allocate_lazy_pheromone( void )
+/*    
+      FUNCTION: allocates the update stamps of the trails and tabulates (1 - rho)^d
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    long int    i;
+
+    pheromone_stamp = (int **) malloc( instance.n * (sizeof(int *) + instance.n * sizeof(int)) );
+    decay_power = (double *) malloc( LAZY_DECAY_STEPS * sizeof(double) );
+    if ( pheromone_stamp == NULL || decay_power == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < instance.n ; i++ )
+        pheromone_stamp[i] = (int *)(pheromone_stamp + instance.n) + i * instance.n;
+    decay_power[0] = 1.0;
+    for ( i = 1 ; i < LAZY_DECAY_STEPS ; i++ )
+        decay_power[i] = decay_power[i-1] * (1 - rho);
+}
+
+void free_lazy_pheromone( void )
+/*    
+      FUNCTION: frees the update stamps of the trails
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    free( pheromone_stamp );
+    free( decay_power );
+}
+
+static double trail_limits( double tau )
+/*    
+      FUNCTION: applies the MMAS trail limits in the lazy mode
+      INPUT:    pheromone trail
+      OUTPUT:   trail within [trail_min,trail_max] for MMAS, else tau
+ */
+{
+    if ( mmas_flag ) {
+        if ( tau < trail_min )
+            return trail_min;
+        if ( tau > trail_max )
+            return trail_max;
+    }
+    return tau;
+}
+
+static double lazy_trail_at( long int i, long int j, long int epoch )
+/*    
+      FUNCTION: computes the trail of arc (i,j) after the update of iteration epoch
+      INPUT:    the two cities of the arc and the iteration, not before its stamp
+      OUTPUT:   pheromone trail including the trail limits
+ */
+{
+    long int    d = epoch - pheromone_stamp[i][j];
+    double      tau = trail_limits( pheromone[i][j] );
+
+    if ( d > 0 ) {
+        tau *= d < LAZY_DECAY_STEPS ? decay_power[d] : pow(1 - rho, (double) d);
+        tau = trail_limits( tau );
+    }
+    return tau;
+}
+
+static double lazy_trail( long int i, long int j )
+/*    
+      FUNCTION: reads the trail of arc (i,j) in the lazy mode
+      INPUT:    the two cities of the arc
+      OUTPUT:   pheromone trail
+ */
+{
+    return lazy_trail_at( i, j, pheromone_epoch );
+}
+
+static double lazy_current_trail( long int i, long int j )
+/*    
+      FUNCTION: reads the trail of arc (i,j) during the pheromone update
+      INPUT:    the two cities of the arc
+      OUTPUT:   pheromone trail after the evaporation of this iteration and the 
+                deposits so far, before the trail limits
+ */
+{
+    if ( pheromone_stamp[i][j] == pheromone_epoch )
+        return pheromone[i][j];
+    return (1 - rho) * lazy_trail_at( i, j, pheromone_epoch - 1 );
+}
+
+static void lazy_set_trail( long int i, long int j, double tau )
+/*    
+      FUNCTION: sets the trail of arc (i,j) in both directions during the pheromone update
+      INPUT:    the two cities of the arc and the pheromone trail
+      OUTPUT:   none
+ */
+{
+    pheromone[i][j] = tau;
+    pheromone[j][i] = tau;
+    pheromone_stamp[i][j] = (int) pheromone_epoch;
+    pheromone_stamp[j][i] = (int) pheromone_epoch;
+}
+
+static void lazy_total_information( void )
+/*    
+      FUNCTION: calculates the total information of the arcs in the candidate lists in 
+                the lazy mode
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    long int    i, j;
+
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            total_nn[i][j] = trail_power(lazy_trail(i, instance.nn_list[i][j])) * eta_nn[i][j];
+        }
+    }
+}
+
+/****************************************************************
+ ****************************************************************
+Procedures for the sparse pheromone representation
+ ****************************************************************
+ ****************************************************************/
+
+/* For large instances the n x n matrices pheromone, total and eta_beta do not fit 
+   into memory. In the sparse mode only the trails of the arcs in the candidate lists 
+   (pheromone_nn, total_nn, eta_nn) are stored, plus up to SPARSE_EXTRA_ARCS further 
+   arcs per city that received pheromone, that is, mostly the arcs of the elite tours 
+   outside the candidate lists. All other arcs have the trail pheromone_default, which 
+   undergoes the same evaporation and trail limits as they would. Memory is O(n * nn_ants). */
+
+void allocate_sparse_pheromone( void )
+/*    
+      FUNCTION: allocates the sparse pheromone representation and the lists of the 
+                cities that have a city in their candidate list
+      INPUT:    none  
+      OUTPUT:   none
+      COMMENTS: the candidate lists have to be computed already
+ */
+{
+    long int    i, j, h, k, n_rev;
+
+    pheromone_nn = generate_double_matrix( instance.n, nn_ants );
+    n_extra = (long int *) calloc( instance.n, sizeof(long int) );
+    rev_start = (long int *) calloc( instance.n + 1, sizeof(long int) );
+    extra_trail = generate_double_matrix( instance.n, SPARSE_EXTRA_ARCS );
+    extra_eta = generate_double_matrix( instance.n, SPARSE_EXTRA_ARCS );
+    extra_total = generate_double_matrix( instance.n, SPARSE_EXTRA_ARCS );
+    /* positions in candidate lists fit into 16 bits, see MAX_NEIGHBOURS */
+    nn_mirror = (short **) malloc( instance.n * (sizeof(short *) + nn_ants * sizeof(short)) );
+    extra_city = (int **) malloc( instance.n * (sizeof(int *) + SPARSE_EXTRA_ARCS * sizeof(int)) );
+    if ( n_extra == NULL || rev_start == NULL || nn_mirror == NULL || extra_city == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        nn_mirror[i] = (short *)(nn_mirror + instance.n) + i * nn_ants;
+        extra_city[i] = (int *)(extra_city + instance.n) + i * SPARSE_EXTRA_ARCS;
+    }
+
+    n_rev = 0;
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            h = instance.nn_list[i][j];
+            nn_mirror[i][j] = -1;
+            for ( k = 0 ; k < nn_ants ; k++ ) {
+                if ( instance.nn_list[h][k] == i ) {
+                    nn_mirror[i][j] = k;
+                    break;
+                }
+            }
+            if ( nn_mirror[i][j] < 0 ) {
+                rev_start[h]++;
+                n_rev++;
+            }
+        }
+    }
+    for ( i = 0 ; i < instance.n ; i++ )
+        rev_start[i+1] += rev_start[i];
+    rev_city = (int *) malloc( (n_rev + 1) * sizeof(int) );
+    rev_pos = (short *) malloc( (n_rev + 1) * sizeof(short) );
+    if ( rev_city == NULL || rev_pos == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = instance.n - 1 ; i >= 0 ; i-- ) {
+        for ( j = nn_ants - 1 ; j >= 0 ; j-- ) {
+            if ( nn_mirror[i][j] < 0 ) {
+                h = instance.nn_list[i][j];
+                rev_start[h]--;
+                rev_city[rev_start[h]] = i;
+                rev_pos[rev_start[h]] = j;
+            }
+        }
+    }
+}
+
+void free_sparse_pheromone( void )
+/*    
+      FUNCTION: frees the sparse pheromone representation
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    free( pheromone_nn );
+    free( nn_mirror );
+    free( n_extra );
+    free( rev_start );
+    free( rev_city );
+    free( rev_pos );
+    free( extra_city );
+    free( extra_trail );
+    free( extra_eta );
+    free( extra_total );
+}
+
+static long int nn_position( long int i, long int j )
+/*    
+      FUNCTION: finds city j in the candidate list of city i
+      INPUT:    the two cities
+      OUTPUT:   position of j in nn_list[i], -1 if it is not there
+ */
+{
+    long int    k;
+
+    for ( k = 0 ; k < nn_ants ; k++ ) {
+        if ( instance.nn_list[i][k] == j )
+            return k;
+    }
+    return -1;
+}
+
+static long int extra_position( long int i, long int j )
+/*    
+      FUNCTION: finds arc (i,j) among the further arcs stored for city i
+      INPUT:    the two cities
+      OUTPUT:   position of j in extra_city[i], -1 if it is not there
+ */
+{
+    long int    s;
+
+    for ( s = 0 ; s < n_extra[i] ; s++ ) {
+        if ( extra_city[i][s] == j )
+            return s;
+    }
+    return -1;
+}
+
+static void drop_extra( long int i, long int s )
+/*    
+      FUNCTION: removes a further arc from the list of one of its cities
+      INPUT:    city and position of the arc in extra_city[i]
+      OUTPUT:   none
+ */
+{
+    long int    t = n_extra[i] - 1;
+
+    extra_city[i][s] = extra_city[i][t];
+    extra_trail[i][s] = extra_trail[i][t];
+    extra_eta[i][s] = extra_eta[i][t];
+    extra_total[i][s] = extra_total[i][t];
+    n_extra[i] = t;
+}
+
+static void remove_extra( long int i, long int s )
+/*    
+      FUNCTION: removes a further arc from both of its cities
+      INPUT:    city and position of the arc in extra_city[i]
+      OUTPUT:   none
+      (SIDE)EFFECTS: the arc has the default trail afterwards
+ */
+{
+    long int    j = extra_city[i][s];
+
+    drop_extra( i, s );
+    drop_extra( j, extra_position( j, i ) );
+}
+
+static long int weakest_extra( long int i )
+/*    
+      FUNCTION: finds the further arc of city i with the lowest trail
+      INPUT:    city
+      OUTPUT:   its position in extra_city[i], -1 if there is still room for an arc
+ */
+{
+    long int    s, weakest;
+
+    if ( n_extra[i] < SPARSE_EXTRA_ARCS )
+        return -1;
+    weakest = 0;
+    for ( s = 1 ; s < n_extra[i] ; s++ ) {
+        if ( extra_trail[i][s] < extra_trail[i][weakest] )
+            weakest = s;
+    }
+    return weakest;
+}
+
+static double sparse_trail( long int i, long int j )
+/*    
+      FUNCTION: reads the trail of arc (i,j) in the sparse mode
+      INPUT:    the two cities
+      OUTPUT:   pheromone trail
+ */
+{
+    long int    k;
+
+    if ( (k = nn_position( i, j )) >= 0 )
+        return pheromone_nn[i][k];
+    if ( (k = nn_position( j, i )) >= 0 )
+        return pheromone_nn[j][k];
+    if ( (k = extra_position( i, j )) >= 0 )
+        return extra_trail[i][k];
+    return pheromone_default;
+}
+
+static void sparse_set_trail( long int i, long int j, double tau )
+/*    
+      FUNCTION: sets the trail of arc (i,j) in both directions in the sparse mode
+      INPUT:    the two cities and the new trail
+      OUTPUT:   none
+      (SIDE)EFFECTS: the total information of the arc is updated; an arc outside the 
+                candidate lists is added to the further arcs of i and j, replacing their 
+                weakest ones if needed. If these are stronger than tau, the arc keeps 
+                the default trail
+ */
+{
+    long int    k, l, s, t;
+    double      eta;
+
+    if ( i == j )
+        return;   /* loops are never used */
+    k = nn_position( i, j );
+    l = nn_position( j, i );
+    if ( k >= 0 ) {
+        pheromone_nn[i][k] = tau;
+        total_nn[i][k] = trail_power(tau) * eta_nn[i][k];
+    }
+    if ( l >= 0 ) {
+        pheromone_nn[j][l] = tau;
+        total_nn[j][l] = trail_power(tau) * eta_nn[j][l];
+    }
+    if ( k >= 0 || l >= 0 )
+        return;
+
+    if ( (s = extra_position( i, j )) >= 0 ) {
+        t = extra_position( j, i );
+        extra_trail[i][s] = extra_trail[j][t] = tau;
+        extra_total[i][s] = extra_total[j][t] = trail_power(tau) * extra_eta[i][s];
+        return;
+    }
+    s = weakest_extra( i );
+    t = weakest_extra( j );
+    if ( (s >= 0 && extra_trail[i][s] >= tau) || (t >= 0 && extra_trail[j][t] >= tau) )
+        return;
+    if ( s >= 0 )
+        remove_extra( i, s );
+    if ( (t = weakest_extra( j )) >= 0 )
+        remove_extra( j, t );
+
+    eta = pow(HEURISTIC(i,j),beta);
+    s = n_extra[i]++;
+    t = n_extra[j]++;
+    extra_city[i][s] = j;
+    extra_city[j][t] = i;
+    extra_trail[i][s] = extra_trail[j][t] = tau;
+    extra_eta[i][s] = extra_eta[j][t] = eta;
+    extra_total[i][s] = extra_total[j][t] = trail_power(tau) * eta;
+}
+
+static void sparse_scale_trails( double factor, long int nn_only )
+/*    
+      FUNCTION: multiplies stored trails by factor
+      INPUT:    factor and whether only the arcs in the candidate lists are affected
+      OUTPUT:   none
+      COMMENTS: as evaporation_nn_list, the trails of the candidate lists are scaled 
+                in one direction only
+ */
+{
+    long int    i, j;
+
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            pheromone_nn[i][j] *= factor;
+        }
+        if ( nn_only )
+            continue;
+        for ( j = 0 ; j < n_extra[i] ; j++ ) {
+            extra_trail[i][j] *= factor;
+        }
+    }
+    if ( !nn_only )
+        pheromone_default *= factor;
+}
+
+static void sparse_trail_limits( double lower, double upper, long int nn_only )
+/*    
+      FUNCTION: forces stored trails to the interval [lower,upper]
+      INPUT:    trail limits and whether only the arcs in the candidate lists are affected
+      OUTPUT:   none
+      (SIDE)EFFECTS: further arcs that end up with the default trail are removed
+ */
+{
+    long int    i, j;
+
+    if ( !nn_only )
+        pheromone_default = MIN(MAX(pheromone_default, lower), upper);
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            pheromone_nn[i][j] = MIN(MAX(pheromone_nn[i][j], lower), upper);
+        }
+        if ( nn_only )
+            continue;
+        for ( j = n_extra[i] - 1 ; j >= 0 ; j-- ) {
+            extra_trail[i][j] = MIN(MAX(extra_trail[i][j], lower), upper);
+            if ( extra_trail[i][j] == pheromone_default && extra_city[i][j] < i )
+                remove_extra( i, j );
+        }
+    }
+}
+
+static void sparse_total_information( void )
+/*    
+      FUNCTION: calculates heuristic info times pheromone for all stored arcs
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    long int    i, j;
+
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        for ( j = 0 ; j < nn_ants ; j++ ) {
+            total_nn[i][j] = trail_power(pheromone_nn[i][j]) * eta_nn[i][j];
+        }
+        for ( j = 0 ; j < n_extra[i] ; j++ ) {
+            extra_total[i][j] = trail_power(extra_trail[i][j]) * extra_eta[i][j];
+        }
+    }
+}
+
+static int better_choice( double value, long int city, double value_best, long int best_city )
+/*    
+      FUNCTION: compares two candidates for the next city as the scan of choose_best_next, 
+                which keeps the first city of maximal value
+      INPUT:    value and city of the candidate and of the best one so far
+      OUTPUT:   TRUE if the candidate is better
+ */
+{
+    return value > value_best || (value == value_best && city < best_city);
+}
+
+static void sparse_choose_best_next( ant_struct *a, long int phase )
+/*    
+      FUNCTION:      chooses for an ant as the next city the one with maximal value of 
+                     heuristic information times pheromone in the sparse mode
+      INPUT:         pointer to ant and the construction step
+      OUTPUT:        none 
+      (SIDE)EFFECT:  ant moves to the chosen city
+      COMMENTS:      the stored arcs of the current city are evaluated first and marked 
+                     with stamp + 1 in the visited vector; all other arcs have the default trail, so the 
+                     best of them leads to the unvisited city with the largest heuristic 
+                     information
+ */
+{ 
+    long int i, pass, city, current_city, next_city, default_city;
+    double   value_best, help;
+    const long int *row;
+
+    current_city = a->tour[phase-1];
+    next_city = instance.n;
+    value_best = -1.;
+
+    for ( pass = 0 ; pass < 2 ; pass++ ) {
+        /* first pass: evaluate and mark the stored arcs, second pass: unmark them */
+        for ( i = 0 ; i < nn_ants ; i++ ) {
+            city = instance.nn_list[current_city][i];
+            if ( pass == 0 && a->visited[city] < a->stamp ) {   /* neither visited nor marked */
+                if ( better_choice( total_nn[current_city][i], city, value_best, next_city ) ) {
+                    value_best = total_nn[current_city][i];
+                    next_city = city;
+                }
+                a->visited[city] = a->stamp + 1;
+            } else if ( pass == 1 && a->visited[city] == a->stamp + 1 ) {
+                a->visited[city] = 0;
+            }
+        }
+        for ( i = rev_start[current_city] ; i < rev_start[current_city+1] ; i++ ) {
+            city = rev_city[i];
+            if ( pass == 0 && a->visited[city] < a->stamp ) {   /* neither visited nor marked */
+                if ( better_choice( total_nn[city][rev_pos[i]], city, value_best, next_city ) ) {
+                    value_best = total_nn[city][rev_pos[i]];
+                    next_city = city;
+                }
+                a->visited[city] = a->stamp + 1;
+            } else if ( pass == 1 && a->visited[city] == a->stamp + 1 ) {
+                a->visited[city] = 0;
+            }
+        }
+        for ( i = 0 ; i < n_extra[current_city] ; i++ ) {
+            city = extra_city[current_city][i];
+            if ( pass == 0 && a->visited[city] < a->stamp ) {   /* neither visited nor marked */
+                if ( better_choice( extra_total[current_city][i], city, value_best, next_city ) ) {
+                    value_best = extra_total[current_city][i];
+                    next_city = city;
+                }
+                a->visited[city] = a->stamp + 1;
+            } else if ( pass == 1 && a->visited[city] == a->stamp + 1 ) {
+                a->visited[city] = 0;
+            }
+        }
+        if ( pass == 1 )
+            break;
+
+        /* the largest heuristic information belongs to the first closest city */
+        row = distance_row( current_city );
+        default_city = instance.n;
+        for ( city = 0 ; city < instance.n ; city++ ) {
+            if ( a->visited[city] < a->stamp && (default_city == instance.n || row[city] < row[default_city]) )
+                default_city = city;
+        }
+        if ( default_city < instance.n ) {
+            help = trail_power(pheromone_default) * pow(HEURISTIC(current_city,default_city),beta);
+            if ( better_choice( help, default_city, value_best, next_city ) ) {
+                value_best = help;
+                next_city = default_city;
+            }
+        }
+    }
+    DEBUG( assert ( 0 <= next_city && next_city < instance.n ); );
+    DEBUG( assert ( !is_visited( a, next_city ) ); )
+    a->tour[phase] = next_city;
+    mark_visited( a, next_city );
 }
 
 /****************************************************************
@@ -271,14 +1181,19 @@ void ant_empty_memory( ant_struct *a )
       FUNCTION:       empty the ants's memory regarding visited cities
       INPUT:          ant identifier
       OUTPUT:         none
-      (SIDE)EFFECTS:  vector of visited cities is reinitialized to FALSE
+      (SIDE)EFFECTS:  no city is visited any more, the packing plan is emptied
+      COMMENTS:       the visited vector is only cleared when stamp would overflow
  */
 {
     long int   i;
 
-    for( i = 0 ; i < instance.n ; i++ ) {
-        a->visited[i]=FALSE;
+    if ( a->stamp >= UINT_MAX - 2 ) {
+        for( i = 0 ; i < instance.n ; i++ ) {
+            a->visited[i] = 0;
+        }
+        a->stamp = 0;
     }
+    a->stamp += 2;
     for( i = 0 ; i < instance.m ; i++ ) {
         a->packing_plan[i]=FALSE;
     }
@@ -294,9 +1209,9 @@ void place_ant( ant_struct *a , long int step )
 {
     long int     rnd;
 
-    rnd = (long int) (ran01( &seed ) * (double) instance.n); /* random number between 0 .. n-1 */
+    rnd = (long int) (rng_ran01( &rng ) * (double) instance.n); /* random number between 0 .. n-1 */
     a->tour[step] = rnd;
-    a->visited[rnd] = TRUE;
+    mark_visited( a, rnd );
 }
 
 void choose_best_next( ant_struct *a, long int phase )
@@ -309,27 +1224,37 @@ void choose_best_next( ant_struct *a, long int phase )
  */
 { 
     long int city, current_city, next_city;
-    double   value_best;
+    double   value_best, help;
 
+    if ( sparse_flag ) {
+        sparse_choose_best_next( a, phase );
+        return;
+    }
     next_city = instance.n;
     DEBUG( assert ( phase > 0 && phase < instance.n ); );
     current_city = a->tour[phase-1];
     value_best = -1.;             /* values in total matrix are always >= 0.0 */
     for ( city = 0 ; city < instance.n ; city++ ) {
-        if ( a->visited[city] )
+        if ( is_visited( a, city ) )
             ; /* city already visited, do nothing */
         else {
-            if ( total[current_city][city] > value_best ) {
+            if ( lazy_flag )
+                help = trail_power(lazy_trail(current_city, city)) * eta_beta[current_city][city];
+            else
+                help = total[current_city][city];
+            if ( total_floor > 0.0 )
+                help = MAX(help, total_floor * eta_beta[current_city][city]);
+            if ( help > value_best ) {
                 next_city = city;
-                value_best = total[current_city][city];
+                value_best = help;
             }
         }
     }
     DEBUG( assert ( 0 <= next_city && next_city < n); );
     DEBUG( assert ( value_best > 0.0 ); )
-    DEBUG( assert ( a->visited[next_city] == FALSE ); )
+    DEBUG( assert ( !is_visited( a, next_city ) ); )
     a->tour[phase] = next_city;
-    a->visited[next_city] = TRUE;
+    mark_visited( a, next_city );
 }
 
 void neighbour_choose_best_next( ant_struct *a, long int phase )
@@ -343,18 +1268,24 @@ void neighbour_choose_best_next( ant_struct *a, long int phase )
 { 
     long int i, current_city, next_city, help_city;
     double   value_best, help;
+    int      *nn;
+    double   *row;
 
     next_city = instance.n;
     DEBUG( assert ( phase > 0 && phase < instance.n ); );
     current_city = a->tour[phase-1];
     DEBUG ( assert ( 0 <= current_city && current_city < instance.n ); )
+    nn = instance.nn_list[current_city];
+    row = total_nn[current_city];
     value_best = -1.;             /* values in total matix are always >= 0.0 */
     for ( i = 0 ; i < nn_ants ; i++ ) {
-        help_city = instance.nn_list[current_city][i];
-        if ( a->visited[help_city] )
+        help_city = nn[i];
+        if ( is_visited( a, help_city ) )
             ;   /* city already visited, do nothing */
         else {
-            help = total[current_city][help_city];
+            help = row[i];
+            if ( total_floor > 0.0 )
+                help = MAX(help, total_floor * eta_nn[current_city][i]);
             if ( help > value_best ) {
                 value_best = help;
                 next_city = help_city;
@@ -367,9 +1298,9 @@ void neighbour_choose_best_next( ant_struct *a, long int phase )
     else {
         DEBUG( assert ( 0 <= next_city && next_city < n); )
         DEBUG( assert ( value_best > 0.0 ); )
-        DEBUG( assert ( a->visited[next_city] == FALSE ); )
+        DEBUG( assert ( !is_visited( a, next_city ) ); )
         a->tour[phase] = next_city;
-        a->visited[next_city] = TRUE;
+        mark_visited( a, next_city );
     }
 }
 
@@ -382,24 +1313,56 @@ void choose_closest_next( ant_struct *a, long int phase )
  */
 { 
     long int city, current_city, next_city, min_distance;
+    const long int *row;
 
     next_city = instance.n;
     DEBUG( assert ( phase > 0 && phase < instance.n ); );
     current_city = a->tour[phase-1];
+    row = distance_row( current_city );
     min_distance = INFTY;             /* Search shortest edge */
     for ( city = 0 ; city < instance.n ; city++ ) {
-        if ( a->visited[city] )
+        if ( is_visited( a, city ) )
             ; /* city already visited */
         else {
-            if ( instance.distance[current_city][city] < min_distance) {
+            if ( row[city] < min_distance) {
                 next_city = city;
-                min_distance = instance.distance[current_city][city];
+                min_distance = row[city];
             }
         }
     }
     DEBUG( assert ( 0 <= next_city && next_city < n); );
     a->tour[phase] = next_city;
-    a->visited[next_city] = TRUE;
+    mark_visited( a, next_city );
+}
+
+static long int roulette_select( const double *cumulative, long int n, double rnd )
+/*    
+      FUNCTION:      find the first entry of the non-decreasing vector cumulative that 
+                     is larger than rnd
+      INPUT:         vector of partial sums, its length and the random value
+      OUTPUT:        index of that entry, n if there is none
+      COMMENTS:      short candidate lists are counted without branches, which the 
+                     compiler vectorizes; longer ones are searched by bisection
+ */
+{
+    long int i, count, low, high, middle;
+
+    if ( n <= ROULETTE_LINEAR ) {
+        count = 0;
+        for ( i = 0 ; i < n ; i++ )
+            count += ( cumulative[i] <= rnd );
+        return count;
+    }
+    low = 0;
+    high = n;
+    while ( low < high ) {
+        middle = (low + high) / 2;
+        if ( cumulative[middle] <= rnd )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
 }
 
 void neighbour_choose_and_move_to_next( ant_struct *a , long int phase )
@@ -410,16 +1373,18 @@ void neighbour_choose_and_move_to_next( ant_struct *a , long int phase )
       INPUT:         pointer to ant the construction step "phase" 
       OUTPUT:        none 
       (SIDE)EFFECT:  ant moves to the chosen city
+      COMMENTS:      prob_of_selection first holds the row of total_nn with the visited 
+                     cities masked out and then its partial sums, the roulette wheel
  */
 { 
     long int i, help;
     long int current_city;
-    double   rnd, partial_sum = 0., sum_prob = 0.0;
-    /*  double   *prob_of_selection; */ /* stores the selection probabilities
-    of the nearest neighbor cities */
+    double   rnd, sum_prob = 0.0;
     double   *prob_ptr;
+    int      *nn;
+    double   *row;
 
-    if ( (q_0 > 0.0) && (ran01( &seed ) < q_0)  ) {
+    if ( (q_0 > 0.0) && (rng_ran01( &rng ) < q_0)  ) {
         /* with a probability q_0 make the best possible choice
        according to pheromone trails and heuristic information */
         /* we first check whether q_0 > 0.0, to avoid the very common case
@@ -433,15 +1398,23 @@ void neighbour_choose_and_move_to_next( ant_struct *a , long int phase )
 
     current_city = a->tour[phase-1]; /* current_city city of ant k */
     DEBUG( assert ( current_city >= 0 && current_city < instance.n ); )
-    for ( i = 0 ; i < nn_ants ; i++ ) {
-        if ( a->visited[instance.nn_list[current_city][i]] )
-            prob_ptr[i] = 0.0;   /* city already visited */
-        else {
-            DEBUG( assert ( instance.nn_list[current_city][i] >= 0 && instance.nn_list[current_city][i] < instance.n ); )
-                prob_ptr[i] = total[current_city][instance.nn_list[current_city][i]];
-            sum_prob += prob_ptr[i];
+    nn = instance.nn_list[current_city];
+    row = total_nn[current_city];
+    if ( total_floor > 0.0 ) {
+        /* incremental mode: the lower MMAS limit is applied here */
+        for ( i = 0 ; i < nn_ants ; i++ ) {
+            prob_ptr[i] = is_visited( a, nn[i] ) ? 0.0 : MAX(row[i], total_floor * eta_nn[current_city][i]);
+        }
+    }
+    else {
+        for ( i = 0 ; i < nn_ants ; i++ ) {
+            prob_ptr[i] = is_visited( a, nn[i] ) ? 0.0 : row[i];   /* 0 if city already visited */
         }
     }
+    for ( i = 0 ; i < nn_ants ; i++ ) {
+        sum_prob += prob_ptr[i];
+        prob_ptr[i] = sum_prob;
+    }
 
     if (sum_prob <= 0.0) {
         /* All cities from the candidate set are tabu */
@@ -450,15 +1423,9 @@ void neighbour_choose_and_move_to_next( ant_struct *a , long int phase )
     else {
         /* at least one neighbor is eligible, chose one according to the
        selection probabilities */
-        rnd = ran01( &seed );
+        rnd = rng_ran01( &rng );
         rnd *= sum_prob;
-        i = 0;
-        partial_sum = prob_ptr[i];
-        /* This loop always stops because prob_ptr[nn_ants] == HUGE_VAL  */
-        while (partial_sum <= rnd) {
-            i++;
-            partial_sum += prob_ptr[i];
-        }
+        i = roulette_select( prob_ptr, nn_ants, rnd );
         /* This may very rarely happen because of rounding if rnd is
            close to 1.  */
         if (i == nn_ants) {
@@ -466,12 +1433,11 @@ void neighbour_choose_and_move_to_next( ant_struct *a , long int phase )
             return;
         }
         DEBUG( assert ( 0 <= i && i < nn_ants); );
-        DEBUG( assert ( prob_ptr[i] >= 0.0); );
-        help = instance.nn_list[current_city][i];
+        help = nn[i];
         DEBUG( assert ( help >= 0 && help < instance.n ); )
-        DEBUG( assert ( a->visited[help] == FALSE ); )
+        DEBUG( assert ( !is_visited( a, help ) ); )
         a->tour[phase] = help; /* instance.nn_list[current_city][i]; */
-        a->visited[help] = TRUE;
+        mark_visited( a, help );
     }
 }
 
@@ -532,24 +1498,22 @@ void copy_from_to(ant_struct *a1, ant_struct *a2)
       INPUT:          pointers to the two ants a1 and a2 
       OUTPUT:         none
       (SIDE)EFFECTS:  a2 is copy of a1
+      COMMENTS:       the visited cities are not copied, they only matter during 
+                      the construction of a tour; only the tour_size entries of the 
+                      tour are copied, the entries behind them are never read
      */
     int   i;
 
     a2->fitness = a1->fitness;
     a2->tour_size = a1->tour_size;
 
-    for ( i = 0 ; i < instance.n ; i++ ) {
+    for ( i = 0 ; i < a1->tour_size ; i++ ) {
         a2->tour[i] = a1->tour[i];
     }
-    a2->tour[instance.n] = a2->tour[0];
     
     for ( i = 0 ; i < instance.m ; i++ ) {
         a2->packing_plan[i] = a1->packing_plan[i];
     }
-    
-    for ( i = 0 ; i < instance.n ; i++ ) {
-        a2->visited[i] = a1->visited[i];
-    }
 }
 
 void allocate_ants ( void )
@@ -558,7 +1522,8 @@ void allocate_ants ( void )
                       the iteration best ant
       INPUT:          none
       OUTPUT:         none
-      (SIDE)EFFECTS:  allocation of memory for the ant colony and two ants that store intermediate tours
+      (SIDE)EFFECTS:  allocation of memory for the ant colony, two ants that store intermediate tours
+                      and the workspace used to compute the packing plans
  */
 {
     long int i;
@@ -569,9 +1534,10 @@ void allocate_ants ( void )
         exit(1);
     }
     for ( i = 0 ; i < n_ants ; i++ ) {
-        ant[i].tour         = (long int *) calloc(instance.n + 1, sizeof(long int));
+        ant[i].tour         = (int *) calloc(instance.n + 1, sizeof(int));
         ant[i].packing_plan = (char *) calloc(instance.m, sizeof(char));
-        ant[i].visited      = (char *) calloc(instance.n, sizeof(char));
+        ant[i].visited      = (unsigned int *) calloc(instance.n, sizeof(unsigned int));
+        ant[i].stamp        = 0;
     }
     
     if((prev_ls_ant = (ant_struct *) malloc(sizeof( ant_struct ) * n_ants +
@@ -580,43 +1546,56 @@ void allocate_ants ( void )
         exit(1);
     }
     for ( i = 0 ; i < n_ants ; i++ ) {
-        prev_ls_ant[i].tour         = (long int *) calloc(instance.n + 1, sizeof(long int));
+        prev_ls_ant[i].tour         = (int *) calloc(instance.n + 1, sizeof(int));
         prev_ls_ant[i].packing_plan = (char *) calloc(instance.m, sizeof(char));
-        prev_ls_ant[i].visited      = (char *) calloc(instance.n, sizeof(char));
+        prev_ls_ant[i].visited      = NULL;
     }
 
     if((best_so_far_ant = (ant_struct *) malloc(sizeof( ant_struct ) )) == NULL){
         printf("Out of memory, exit.");
         exit(1);
     }
-    best_so_far_ant->tour           = (long int *) calloc(instance.n + 1, sizeof(long int));
+    best_so_far_ant->tour           = (int *) calloc(instance.n + 1, sizeof(int));
     best_so_far_ant->packing_plan   = (char *) calloc(instance.m, sizeof(char));
-    best_so_far_ant->visited        = (char *) calloc(instance.n, sizeof(char));
+    best_so_far_ant->visited        = NULL;
     
     if((restart_best_ant = (ant_struct *) malloc(sizeof( ant_struct ) )) == NULL){
         printf("Out of memory, exit.");
         exit(1);
     }
-    restart_best_ant->tour           = (long int *) calloc(instance.n + 1, sizeof(long int));
+    restart_best_ant->tour           = (int *) calloc(instance.n + 1, sizeof(int));
     restart_best_ant->packing_plan   = (char *) calloc(instance.m, sizeof(char));
-    restart_best_ant->visited        = (char *) calloc(instance.n, sizeof(char));
+    restart_best_ant->visited        = NULL;
     
     if((global_best_ant = (ant_struct *) malloc(sizeof( ant_struct ) )) == NULL){
         printf("Out of memory, exit.");
         exit(1);
     }
         
-    global_best_ant->tour           = (long int *) calloc(instance.n + 1, sizeof(long int));
+    global_best_ant->tour           = (int *) calloc(instance.n + 1, sizeof(int));
     global_best_ant->packing_plan   = (char *) calloc(instance.m, sizeof(char));
-    global_best_ant->visited        = (char *) calloc(instance.n, sizeof(char));    
+    global_best_ant->visited        = NULL;    
     global_best_ant->fitness = INFTY;    
 
     if ((prob_of_selection = (double *) malloc(sizeof(double) * (nn_ants + 1))) == NULL) {
         printf("Out of memory, exit.");
         exit(1);
     }
-    /* Ensures that we do not run over the last element in the random wheel.  */
-    prob_of_selection[nn_ants] = HUGE_VAL;
+
+    tour_position  = (int *) malloc(instance.n * sizeof(int));
+    position_stamp = (unsigned int *) calloc(instance.n, sizeof(unsigned int));
+    position_epoch = 0;
+
+    if ( paco_flag )
+        allocate_paco_archive();
+
+    packing_ws = allocate_packing_workspace();
+    if ( ls_flag ) {
+        ls_ws = allocate_ls_workspace();
+        if ( dlb_seed_flag )
+            allocate_ls_reference();
+    }
+    allocate_packing_cache();
 }
 
 /*
@@ -630,8 +1609,8 @@ long int nn_tour( void )
     
     ant[0].tour_size = 1;
     ant[0].tour[0] = 0;
-    ant[0].visited[0] = TRUE;
-    ant[0].visited[instance.n - 1] = TRUE;
+    mark_visited( &ant[0], 0 );
+    mark_visited( &ant[0], instance.n - 1 );
 
     phase = 0; 
 
@@ -665,7 +1644,7 @@ long int nn_tour( void )
     }
     n_tours += 1;
 
-    ant[0].fitness = compute_fitness( ant[0].tour, ant[0].visited, ant[0].tour_size, ant[0].packing_plan );
+    ant[0].fitness = compute_fitness( ant[0].tour, ant[0].tour_size, ant[0].packing_plan, packing_ws );
     copy_from_to( &ant[0], best_so_far_ant );    
     
     help = ant[0].fitness;
@@ -680,19 +1659,24 @@ long int nn_tour( void )
       INPUT:          none
       OUTPUT:         none
       (SIDE)EFFECTS:  needs ant colony and one statistic ants
+      COMMENTS:       packing and local search draw from a stream of their own, next to 
+                      the ones of the ants and of the BWAS mutation, so the tour does not 
+                      depend on how earlier tries were split among the threads
  */
 {
     long int phase, help;
 
+    rng_init_stream( &rng, n_try, 0, 2 * n_ants + 2 );
+
     ant_empty_memory( &ant[0] );
 
     /* Place the ant 0 at initial city 0 and set the final city as n-1 */
     ant[0].tour[0] = 0;
-    ant[0].visited[0] = TRUE;
+    mark_visited( &ant[0], 0 );
     ant[0].tour[instance.n - 2] = instance.n - 2;
-    ant[0].visited[instance.n - 2] = TRUE;
+    mark_visited( &ant[0], instance.n - 2 );
     ant[0].tour[instance.n - 1] = instance.n - 1;
-    ant[0].visited[instance.n - 1] = TRUE;
+    mark_visited( &ant[0], instance.n - 1 );
 
     phase = 0; /* counter of the construction steps */
 
@@ -716,6 +1700,11 @@ long int nn_tour( void )
         case 3:
             three_opt_first( ant[0].tour, ant[0].tour_size );  /* 3-opt local search */
             break;
+        case 4:
+            or_opt_first( ant[0].tour, ant[0].tour_size );     /* 2-opt and Or-opt local search */
+            break;
+        case 5:
+            break;  /* needs the packing plan, applied below */
         default:
             fprintf(stderr,"type of local search procedure not correctly specified\n");
             exit(1);
@@ -723,7 +1712,9 @@ long int nn_tour( void )
 
     n_tours += 1;
 
-    ant[0].fitness = compute_fitness( ant[0].tour, ant[0].visited, ant[0].tour_size, ant[0].packing_plan);
+    ant[0].fitness = compute_fitness( ant[0].tour, ant[0].tour_size, ant[0].packing_plan, packing_ws);
+    if ( ls_flag == 5 )
+        ant[0].fitness = packing_opt_first( ant[0].tour, &ant[0].tour_size, ant[0].packing_plan );
     copy_from_to( &ant[0], best_so_far_ant );    
     
     help = ant[0].fitness;
@@ -731,6 +1722,52 @@ long int nn_tour( void )
     return help;
 }
 
+static void index_tour( const ant_struct *a )
+/*    
+      FUNCTION:       record the position of each city in the tour of ant a
+      INPUT:          pointer to the ant
+      OUTPUT:         none
+      (SIDE)EFFECTS:  indexed_position answers for the tour of a until the next call
+      COMMENTS:       older positions are invalidated by advancing position_epoch, so the 
+                      cost is O(tour_size) instead of O(n); the stamps are only cleared 
+                      when position_epoch would wrap around
+ */
+{
+    long int i;
+
+    if ( position_epoch == UINT_MAX ) {
+        for ( i = 0 ; i < instance.n ; i++ )
+            position_stamp[i] = 0;
+        position_epoch = 0;
+    }
+    position_epoch++;
+    for ( i = 0 ; i < a->tour_size - 1 ; i++ ) {
+        tour_position[a->tour[i]] = i;
+        position_stamp[a->tour[i]] = position_epoch;
+    }
+}
+
+static long int indexed_position( long int city )
+/*    
+      FUNCTION:       position of a city in the tour last passed to index_tour
+      INPUT:          city
+      OUTPUT:         its position, -1 if the city is not in the tour
+ */
+{
+    return position_stamp[city] == position_epoch ? tour_position[city] : -1;
+}
+
+void free_tour_index( void )
+/*    
+      FUNCTION:       free the position index used to compare tours
+      INPUT:          none
+      OUTPUT:         none
+ */
+{
+    free( tour_position );
+    free( position_stamp );
+}
+
 long int distance_between_ants( ant_struct *a1, ant_struct *a2)
 /*    
       FUNCTION: compute the distance between the tours of ant a1 and a2
@@ -740,24 +1777,17 @@ long int distance_between_ants( ant_struct *a1, ant_struct *a2)
 {  
     long int    i, j, h, pos, pred;
     long int    distance;
-    long int    *pos2;        /* positions of cities in tour of ant a2 */
 
-    pos2 = (long int *) malloc(instance.n * sizeof(long int));
-    for ( i = 0 ; i < instance.n ; i++ ) {
-        pos2[i] = -1;
-    }
-    for ( i = 0 ; i < instance.n ; i++ ) {
-        pos2[a2->tour[i]] = i;
-    }
+    index_tour( a2 );
 
     distance = 0;
-    for ( i = 0 ; i < instance.n ; i++ ) {
+    for ( i = 0 ; i < a1->tour_size - 1 ; i++ ) {
         j = a1->tour[i];
         h = a1->tour[i+1];
-        pos = pos2[j];
+        pos = indexed_position( j );
         if (pos == -1) { distance++; continue; }
         if (pos - 1 < 0)
-            pred = instance.n - 1;
+            pred = a2->tour_size - 2;
         else
             pred = pos - 1;
         if (a2->tour[pos+1] == h)
@@ -768,7 +1798,6 @@ long int distance_between_ants( ant_struct *a1, ant_struct *a2)
             distance++;
         }
     }
-    free ( pos2 );
     return distance;
 }
 
@@ -804,6 +1833,21 @@ void population_statistics(void)
     free(l);
 }
 
+static double candidate_trail( long int m, long int i )
+/*    
+      FUNCTION:       reads the trail of an arc in the candidate list of city m
+      INPUT:          city m and position i in its candidate list
+      OUTPUT:         pheromone trail, at least pheromone_floor
+      COMMENTS:       pheromone_floor is the lower MMAS limit of the incremental mode, else 0 
+ */
+{
+    if ( sparse_flag )
+        return pheromone_nn[m][i];
+    if ( lazy_flag )
+        return lazy_trail(m, instance.nn_list[m][i]);
+    return MAX(pheromone[m][instance.nn_list[m][i]], pheromone_floor);
+}
+
 double node_branching(double l)
 /*    
       FUNCTION:       compute the average node lambda-branching factor 
@@ -815,7 +1859,7 @@ double node_branching(double l)
  */
 {
     long int i, m;
-    double min, max, cutoff;
+    double min, max, cutoff, trail;
     double avg;
     double * num_branches;
 
@@ -823,18 +1867,19 @@ double node_branching(double l)
 
     for (m = 0; m < instance.n; m++) {
         /* determine max, min to calculate the cutoff value */
-        min = pheromone[m][instance.nn_list[m][1]];
-        max = pheromone[m][instance.nn_list[m][1]];
+        min = candidate_trail(m, 1);
+        max = min;
         for (i = 1; i < nn_ants; i++) {
-            if (pheromone[m][instance.nn_list[m][i]] > max)
-                max = pheromone[m][instance.nn_list[m][i]];
-            if (pheromone[m][instance.nn_list[m][i]] < min)
-                min = pheromone[m][instance.nn_list[m][i]];
+            trail = candidate_trail(m, i);
+            if (trail > max)
+                max = trail;
+            if (trail < min)
+                min = trail;
         }
         cutoff = min + l * (max - min);
 
         for (i = 0; i < nn_ants; i++) {
-            if (pheromone[m][instance.nn_list[m][i]] > cutoff)
+            if (candidate_trail(m, i) > cutoff)
                 num_branches[m] += 1.;
         }
     }
@@ -867,6 +1912,11 @@ void mmas_evaporation_nn_list( void )
 
     TRACE ( printf("mmas specific evaporation on nn_lists\n"); );
 
+    if ( sparse_flag ) {
+        sparse_scale_trails( 1 - rho, TRUE );
+        sparse_trail_limits( trail_min, HUGE_VAL, TRUE );
+        return;
+    }
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j < nn_ants ; j++ ) {
             help_city = instance.nn_list[i][j];
@@ -893,6 +1943,10 @@ void check_nn_list_pheromone_trail_limits( void )
 
     TRACE ( printf("mmas specific: check pheromone trail limits nn_list\n"); );
 
+    if ( sparse_flag ) {
+        sparse_trail_limits( trail_min, trail_max, TRUE );
+        return;
+    }
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j < nn_ants ; j++ ) {
             help_city = instance.nn_list[i][j];
@@ -917,6 +1971,12 @@ void check_pheromone_trail_limits( void )
 
     TRACE ( printf("mmas specific: check pheromone trail limits\n"); );
 
+    if ( sparse_flag ) {
+        sparse_trail_limits( trail_min, trail_max, FALSE );
+        return;
+    }
+    if ( lazy_flag )
+        return;   /* the limits are applied when a trail is read, see lazy_trail */
     for ( i = 0 ; i < instance.n ; i++ ) {
         for ( j = 0 ; j < i ; j++ ) {
             if ( pheromone[i][j] < trail_min ) {
@@ -952,15 +2012,21 @@ void global_acs_pheromone_update( ant_struct *a )
 
     d_tau = 1.0 / (double) a->fitness;
 
-    for ( i = 0 ; i < instance.n ; i++ ) {
+    for ( i = 0 ; i < a->tour_size - 1 ; i++ ) {
         j = a->tour[i];
         h = a->tour[i+1];
 
+        if ( sparse_flag ) {
+            sparse_set_trail( j, h, (1. - rho) * sparse_trail( j, h ) + rho * d_tau );
+            continue;
+        }
         pheromone[j][h] = (1. - rho) * pheromone[j][h] + rho * d_tau;
         pheromone[h][j] = pheromone[j][h];
 
-        total[h][j] = pow(pheromone[h][j], alpha) * pow(HEURISTIC(h,j),beta);
+        total[h][j] = trail_power(pheromone[h][j]) * eta_beta[h][j];
         total[j][h] = total[h][j];
+        update_total_nn_entry( h, j );
+        update_total_nn_entry( j, h );
     }
 }
 
@@ -986,10 +2052,16 @@ void local_acs_pheromone_update( ant_struct *a, long int phase )
     DEBUG ( assert ( 0 <= j && j < instance.n ); )
     DEBUG ( assert ( 0 <= h && h < instance.n ); )
     /* still additional parameter has to be introduced */
+    if ( sparse_flag ) {
+        sparse_set_trail( h, j, (1. - 0.1) * sparse_trail( h, j ) + 0.1 * trail_0 );
+        return;
+    }
     pheromone[h][j] = (1. - 0.1) * pheromone[h][j] + 0.1 * trail_0;
     pheromone[j][h] = pheromone[h][j];
-    total[h][j] = pow(pheromone[h][j], alpha) * pow(HEURISTIC(h,j),beta);
+    total[h][j] = trail_power(pheromone[h][j]) * eta_beta[h][j];
     total[j][h] = total[h][j];
+    update_total_nn_entry( h, j );
+    update_total_nn_entry( j, h );
 }
 
 /****************************************************************
@@ -1008,35 +2080,35 @@ void bwas_worst_ant_update( ant_struct *a1, ant_struct *a2)
  */
 {  
     long int    i, j, h, pos, pred;
-    long int    distance;
-    long int    *pos2;        /* positions of cities in tour of ant a2 */
 
     TRACE ( printf("bwas specific: best-worst pheromone update\n"); );
 
-    pos2 = (long int *) malloc(instance.n * sizeof(long int));
-    for ( i = 0 ; i < instance.n ; i++ ) {
-        pos2[a2->tour[i]] = i;
-    }
+    index_tour( a2 );
 
-    distance = 0;
-    for ( i = 0 ; i < instance.n ; i++ ) {
+    for ( i = 0 ; i < a1->tour_size - 1 ; i++ ) {
         j = a1->tour[i];
         h = a1->tour[i+1];
-        pos = pos2[j];
+        pos = indexed_position( j );
         if (pos - 1 < 0)
-            pred = instance.n - 1;
+            pred = a2->tour_size - 2;
         else
             pred = pos - 1;
-        if (a2->tour[pos+1] == h)
+        /* pos == -1: city j, hence edge (j,h), does not occur in ant a2 */
+        if (pos != -1 && a2->tour[pos+1] == h)
             ; /* do nothing, edge is common with a2 (best solution found so far) */
-        else if (a2->tour[pred] == h)
+        else if (pos != -1 && a2->tour[pred] == h)
             ; /* do nothing, edge is common with a2 (best solution found so far) */
+        else if ( sparse_flag ) {
+            sparse_set_trail( j, h, (1 - rho) * sparse_trail( j, h ) );
+        }
+        else if ( lazy_flag ) {
+            lazy_set_trail( j, h, (1 - rho) * lazy_current_trail( j, h ) );
+        }
         else {   /* edge (j,h) does not occur in ant a2 */
             pheromone[j][h] = (1 - rho) * pheromone[j][h];
             pheromone[h][j] = (1 - rho) * pheromone[h][j];
         }
     }
-    free ( pos2 );
 }
 
 void bwas_pheromone_mutation( void )
@@ -1049,21 +2121,27 @@ void bwas_pheromone_mutation( void )
     long int     i, j, k;
     long int     num_mutations;
     double       avg_trail = 0.0, mutation_strength = 0.0, mutation_rate = 0.3;
+    double       tau;
 
     TRACE ( printf("bwas specific: pheromone mutation\n"); );
 
     /* compute average pheromone trail on edges of global best solution */
-    for ( i = 0 ; i < instance.n ; i++ ) {
-        avg_trail +=  pheromone[best_so_far_ant->tour[i]][best_so_far_ant->tour[i+1]];
+    for ( i = 0 ; i < best_so_far_ant->tour_size - 1 ; i++ ) {
+        if ( sparse_flag )
+            avg_trail += sparse_trail( best_so_far_ant->tour[i], best_so_far_ant->tour[i+1] );
+        else if ( lazy_flag )
+            avg_trail += lazy_current_trail( best_so_far_ant->tour[i], best_so_far_ant->tour[i+1] );
+        else
+            avg_trail +=  pheromone[best_so_far_ant->tour[i]][best_so_far_ant->tour[i+1]];
     }
-    avg_trail /= (double) instance.n;
+    avg_trail /= (double) (best_so_far_ant->tour_size - 1);
 
     /* determine mutation strength of pheromone matrix */
     /* FIXME: we add a small value to the denominator to avoid any
        potential division by zero. This may not be fully correct
        according to the original BWAS. */
     if ( max_time > 0.1 )
-        mutation_strength = 4. * avg_trail * (elapsed_time(VIRTUAL) - restart_time) / (max_time - restart_time + 0.0001);
+        mutation_strength = 4. * avg_trail * (elapsed_time( timer_type ) - restart_time) / (max_time - restart_time + 0.0001);
     else if ( max_tours > 100 )
         mutation_strength = 4. * avg_trail * (iteration - restart_iteration)
         / (max_tours - restart_iteration + 1);
@@ -1078,10 +2156,24 @@ void bwas_pheromone_mutation( void )
     if ( restart_iteration < 2 )
         num_mutations = 0;
 
+    /* the mutation has its own stream, next to the ones of the ants in this iteration */
+    rng_init_stream( &rng, n_try, iteration, 2 * n_ants + 1 );
+
     for ( i = 0 ; i < num_mutations ; i++ ) {
-        j =   (long int) (ran01( &seed ) * (double) instance.n);
-        k =   (long int) (ran01( &seed ) * (double) instance.n);
-        if ( ran01( &seed ) < 0.5 ) {
+        j =   (long int) (rng_ran01( &rng ) * (double) instance.n);
+        k =   (long int) (rng_ran01( &rng ) * (double) instance.n);
+        if ( sparse_flag || lazy_flag ) {
+            tau = sparse_flag ? sparse_trail( j, k ) : lazy_current_trail( j, k );
+            if ( rng_ran01( &rng ) < 0.5 )
+                tau += mutation_strength;
+            else if ( (tau -= mutation_strength) <= 0.0 )
+                tau = EPSILON;
+            if ( sparse_flag )
+                sparse_set_trail( j, k, tau );
+            else
+                lazy_set_trail( j, k, tau );
+        }
+        else if ( rng_ran01( &rng ) < 0.5 ) {
             pheromone[j][k] += mutation_strength;
             pheromone[k][j] = pheromone[j][k];
         }
@@ -1094,3 +2186,115 @@ void bwas_pheromone_mutation( void )
         }
     }
 }
+
+/****************************************************************
+ ****************************************************************
+Procedures specific to Population-based ACO
+ ****************************************************************
+ ****************************************************************/
+
+/* P-ACO (Guntsch and Middendorf) does not evaporate. The trail of an arc is trail_0 
+   plus paco_delta for each tour of a FIFO archive of paco_size tours that contains 
+   it. A tour entering or leaving the archive changes the trails and the total 
+   information of its own arcs only. */
+
+void allocate_paco_archive( void )
+/*    
+      FUNCTION: allocates the archive of population-based ACO
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    long int    i;
+
+    paco_tour = (int **) malloc( paco_size * (sizeof(int *) + (instance.n + 1) * sizeof(int)) );
+    paco_tour_size = (long int *) calloc( paco_size, sizeof(long int) );
+    if ( paco_tour == NULL || paco_tour_size == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < paco_size ; i++ )
+        paco_tour[i] = (int *)(paco_tour + paco_size) + i * (instance.n + 1);
+}
+
+void free_paco_archive( void )
+/*    
+      FUNCTION: frees the archive of population-based ACO
+      INPUT:    none  
+      OUTPUT:   none
+ */
+{
+    free( paco_tour );
+    free( paco_tour_size );
+}
+
+void paco_init_archive( void )
+/*    
+      FUNCTION: empties the archive of population-based ACO
+      INPUT:    none  
+      OUTPUT:   none
+      COMMENTS: the trails have to be initialized with trail_0; a full archive raises 
+                the trail of an arc up to 1
+ */
+{
+    paco_count = 0;
+    paco_oldest = 0;
+    paco_delta = (1. - trail_0) / (double) paco_size;
+}
+
+static void paco_change_trails( const int *tour, long int tour_size, long int change )
+/*    
+      FUNCTION: adds or removes the contribution of an archive tour to the trails
+      INPUT:    tour, its number of entries and +1 (tour enters) or -1 (tour leaves)
+      OUTPUT:   none
+      (SIDE)EFFECTS: the trails and the total information of the tour's arcs are updated 
+                in both directions
+      COMMENTS: a trail is kept at trail_0 plus a multiple of paco_delta, so that no 
+                rounding error accumulates
+ */
+{
+    long int    i, j, h, count;
+    double      tau;
+
+    for ( i = 0 ; i < tour_size - 1 ; i++ ) {
+        j = tour[i];
+        h = tour[i+1];
+        tau = sparse_flag ? sparse_trail( j, h ) : pheromone[j][h];
+        count = (long int) floor( (tau - trail_0) / paco_delta + 0.5 ) + change;
+        tau = trail_0 + (double) MAX(count, 0) * paco_delta;
+        if ( sparse_flag ) {
+            sparse_set_trail( j, h, tau );
+            continue;
+        }
+        pheromone[j][h] = tau;
+        pheromone[h][j] = tau;
+        total[j][h] = trail_power(tau) * eta_beta[j][h];
+        total[h][j] = total[j][h];
+        update_total_nn_entry( j, h );
+        update_total_nn_entry( h, j );
+    }
+}
+
+void paco_archive_update( ant_struct *a )
+/*    
+      FUNCTION: the tour of an ant enters the archive of population-based ACO; if the 
+                archive is full, its oldest tour leaves it
+      INPUT:    pointer to the ant
+      OUTPUT:   none
+ */
+{
+    long int    i;
+
+    TRACE ( printf("P-ACO archive update\n"); );
+
+    if ( paco_count == paco_size )
+        paco_change_trails( paco_tour[paco_oldest], paco_tour_size[paco_oldest], -1 );
+    else
+        paco_count++;
+
+    for ( i = 0 ; i < a->tour_size ; i++ )
+        paco_tour[paco_oldest][i] = a->tour[i];
+    paco_tour_size[paco_oldest] = a->tour_size;
+    paco_change_trails( a->tour, a->tour_size, +1 );
+    paco_oldest = (paco_oldest + 1) % paco_size;
+}
@@ -52,7 +52,7 @@
 
 
 
-#define HEURISTIC(m,n)     (1.0 / ((double) instance.distance[m][n] + 0.1))
+#define HEURISTIC(m,n)     (1.0 / ((double) instance_distance(m,n) + 0.1))
 /* add a small constant to avoid division by zero if a distance is 
 zero */
 
@@ -60,19 +60,38 @@ zero */
 
 #define MAX_ANTS       1024    /* max no. of ants */
 #define MAX_NEIGHBOURS 512     /* max. no. of nearest neighbours in candidate set */
+#define ROULETTE_LINEAR 32     /* max. length of candidate lists searched linearly in the roulette wheel */
+#define SPARSE_MIN_CITIES 10000 /* by default, instances with more cities use the sparse pheromone representation */
+#define SPARSE_EXTRA_ARCS 8    /* max. no. of arcs outside the candidate lists stored per city in the sparse mode */
+#define LAZY_DECAY_STEPS 1024  /* (1 - rho)^d is tabulated for d < LAZY_DECAY_STEPS in the lazy mode */
 
 /* Note that *tour needs to be allocated for length n+1 since the first city of 
 a tour (at position 0) is repeated at position n. This is done to make the 
-computation of the tour length easier 
+computation of the tour length easier. Only the first tour_size entries are 
+valid; the first city is repeated at position tour_size - 1.
+A city is visited in the current construction if its entry of *visited equals 
+stamp; ant_empty_memory only advances stamp, by two, so that stamp + 1 can 
+serve as a temporary mark.
  */
 typedef struct {
-    long int  *tour;
+    int       *tour;
     char      *packing_plan;
-    char      *visited;
+    unsigned int *visited;
+    unsigned int stamp;
     long int  fitness;    
     long int tour_size;    
 } ant_struct;
 
+static inline int is_visited( const ant_struct *a, long int city )
+{
+    return a->visited[city] == a->stamp;
+}
+
+static inline void mark_visited( ant_struct *a, long int city )
+{
+    a->visited[city] = a->stamp;
+}
+
 extern ant_struct *ant;               /* this (array of) struct will hold the colony */
 extern ant_struct *prev_ls_ant;       
 extern ant_struct *best_so_far_ant;   /* struct that contains the best-so-far ant */
@@ -81,8 +100,25 @@ extern ant_struct *global_best_ant;   /* struct that contains the global-best an
 
 extern double   **pheromone; /* pheromone matrix, one entry for each arc */
 extern double   **total;     /* combination of pheromone times heuristic information */
+extern double   **total_nn;  /* total information of the arcs in the candidate lists, aligned with nn_list */
+
+extern double   **eta_beta;  /* heuristic information to the power of beta */
+extern double   **eta_nn;    /* eta_beta of the arcs in the candidate lists, aligned with nn_list */
+
+extern long int incremental_flag; /* = 1, update the total information only on arcs that receive pheromone */
+extern double   pheromone_scale;  /* incremental mode: a trail is pheromone_scale * pheromone[i][j] */
+extern double   pheromone_floor;  /* incremental mode: lower MMAS limit relative to pheromone_scale, else 0 */
+extern double   total_floor;      /* incremental mode: pheromone_floor^alpha, else 0 */
+
+extern long int lazy_flag;        /* = 1, evaporate the trail of an arc when it is read */
+
+extern long int sparse_flag;      /* = 1, store only the trails of candidate list and elite arcs, -1: decide by size */
+extern double   **pheromone_nn;   /* sparse mode: trails of the arcs in the candidate lists, aligned with nn_list */
+extern double   pheromone_default; /* sparse mode: trail of all arcs that are not stored */
 
-extern double   *prob_of_selection;
+extern double   pow_ulps;    /* error budget of tau^alpha in ulps, 0: exact pow */
+
+extern __thread double *prob_of_selection;  /* each thread has its own selection probabilities */
 
 
 extern long int n_ants;      /* number of ants */
@@ -99,6 +135,9 @@ extern long int ras_flag;    /* = 1, run rank-based version of ant system */
 extern long int mmas_flag;   /* = 1, run MAX-MIN ant system */
 extern long int bwas_flag;   /* = 1, run best-worst ant system */
 extern long int acs_flag;    /* = 1, run ant colony system */
+extern long int paco_flag;   /* = 1, run population-based ACO */
+
+extern long int step_major_flag; /* = 1, move all ants one step at a time instead of building one tour after the other */
 
 extern long int elitist_ants;    /* additional parameter for elitist ant system, it defines the number of elitist ants */
 
@@ -110,6 +149,8 @@ extern long int u_gb;            /* every u_gb iterations update with best-so-fa
 
 extern double   trail_0;         /* initial pheromone trail level in ACS  and BWAS */
 
+extern long int paco_size;       /* number of tours in the archive of population-based ACO */
+
 /* Pheromone manipulation etc. */
 
 void init_pheromone_trails ( double initial_trail );
@@ -126,6 +167,24 @@ void compute_total_information( void );
 
 void compute_nn_list_total_information( void );
 
+void compute_total_nn_information( void );
+
+void compute_heuristic_information( void );
+
+void incremental_evaporation( void );
+
+void incremental_deposit( long int j, long int h, double d_tau );
+
+void incremental_total_information( void );
+
+void allocate_lazy_pheromone( void );
+
+void free_lazy_pheromone( void );
+
+void allocate_sparse_pheromone( void );
+
+void free_sparse_pheromone( void );
+
 /* Ants' solution construction */
 
 void ant_empty_memory( ant_struct *a );
@@ -154,6 +213,8 @@ long int nn_tour( void );
 
 long int distance_between_ants( ant_struct *a1, ant_struct *a2);
 
+void free_tour_index( void );
+
 void population_statistics(void);
 
 double node_branching(double l);
@@ -177,3 +238,13 @@ void local_acs_pheromone_update( ant_struct *a, long int phase );
 void bwas_worst_ant_update( ant_struct *a1, ant_struct *a2);
 
 void bwas_pheromone_mutation( void );
+
+/* Procedures specific to Population-based ACO */
+
+void allocate_paco_archive( void );
+
+void free_paco_archive( void );
+
+void paco_init_archive( void );
+
+void paco_archive_update( ant_struct *a );
@@ -64,6 +64,7 @@
 #include "ants.h"
 #include "ls.h"
 #include "parse.h"
+#include "threads.h"
 
 long int *best_in_try;
 long int *best_found_at;
@@ -78,6 +79,7 @@ double restart_time; /* remember time when restart was done if any */
 long int max_tries; /* maximum number of independent tries */
 long int max_tours; /* maximum number of tour constructions in one try */
 long int max_packing_tries; /* number of tries to construct a good packing plan from a give tour */
+long int partial_sort_flag; /* = 1, sort the items of a packing try lazily, only as far as needed */
 long int seed;
 
 double lambda; /* Parameter to determine branching factor */
@@ -86,6 +88,10 @@ double branch_fac; /* If branching factor < branch_fac => update trails */
 double max_time; /* maximal allowed run time of a try  */
 double time_used; /* time used until some given event */
 double time_passed; /* time passed until some moment*/
+double construction_time; /* time spent in the solution construction in the current try */
+double ls_time;           /* time spent in the local search in the current try */
+long int n_ls_ants;       /* number of ants that underwent local search in the current try */
+long int first_iteration_allocations; /* workspace allocations done until the end of the first iteration */
 long int optimal; /* optimal solution or bound to find */
 
 double mean_ants; /* average tour length */
@@ -142,6 +148,12 @@ void init_program(long int argc, char * argv[])
 
     nn_ants = MIN(nn_ants, instance.n);
 
+    if ( sparse_flag < 0 ) sparse_flag = instance.n > SPARSE_MIN_CITIES;
+    /* the incremental mode works on the full matrices */
+    if ( sparse_flag ) incremental_flag = FALSE;
+    /* the lazy mode replaces the evaporation of all trails, which is only done without local search */
+    if ( sparse_flag || incremental_flag || ls_flag ) lazy_flag = FALSE;
+
     if (n_ants < 0) n_ants = instance.n;
     /* default setting for elitist_ants is 0; if EAS is applied and
        option elitist_ants is not used, we set the default to
@@ -162,11 +174,25 @@ void init_program(long int argc, char * argv[])
         log_file = NULL;
     }
 
-    instance.distance = compute_distances();
+    if ( matrix_free_flag < 0 ) matrix_free_flag = instance.n > MATRIX_FREE_MIN_CITIES;
+    instance.distance = NULL;
+    instance.compact_distance = NULL;
+    if ( matrix_free_flag ) {
+        init_distance_on_demand();
+    } else if ( compact_flag && (instance.compact_distance = compute_compact_distances()) != NULL ) {
+        ; /* all distances fit into 32 bits */
+    } else {
+        compact_flag = FALSE;
+        instance.distance = compute_distances();
+    }
+    /* city indices are stored in 32 bits */
+    assert(instance.n < INT_MAX);
     
     write_params();
     
     allocate_ants();
+
+    start_thread_pool();
 }
 
 void exit_program(void)
@@ -206,8 +232,11 @@ void init_try( long int ntry )
     TRACE ( printf("INITIALIZE TRIAL\n"); );
 
     start_timers();
-    time_used = elapsed_time( VIRTUAL );
+    time_used = elapsed_time( timer_type );
     time_passed = time_used;
+    construction_time = 0.0;
+    ls_time = 0.0;
+    n_ls_ants = 0;
 
     /* Initialize variables concerning statistics etc. */
 
@@ -216,11 +245,12 @@ void init_try( long int ntry )
     restart_iteration = 1;
     lambda       = 0.05;
     best_so_far_ant->fitness = INFTY;
+    restart_best_ant->fitness = INFTY;
     found_best   = 0;
 
     /* Initialize the Pheromone trails, only if ACS is used, pheromones
        have to be initialized differently */
-    if ( !(acs_flag || mmas_flag || bwas_flag) ) {
+    if ( !(acs_flag || mmas_flag || bwas_flag || paco_flag) ) {
         trail_0 = 1. / ( (rho) * nn_tour() );
         /* in the original papers on Ant System, Elitist Ant System, and
            Rank-based Ant System it is not exactly defined what the
@@ -242,10 +272,19 @@ void init_try( long int ntry )
         trail_0 = 1. / ( (double) instance.n * (double) nn_tour( ) ) ;
         init_pheromone_trails( trail_0 );
     }
+    if ( paco_flag ) {
+        /* as in Guntsch and Middendorf's P-ACO, the archive tours raise a trail 
+           from 1 / (n - 1) up to 1 */
+        trail_0 = 1. / (double) ( instance.n - 1 );
+        init_pheromone_trails( trail_0 );
+        paco_init_archive();
+    }
 
     /* Calculate combined information pheromone times heuristic information */
     compute_total_information();
 
+    clear_packing_cache();
+
     if (log_file) fprintf(log_file,"\nbegin try %li \n",ntry);
 }
 
@@ -260,13 +299,27 @@ void exit_try(long int ntry)
     best_in_try[ntry] = best_so_far_ant->fitness;
     best_found_at[ntry] = found_best;
     time_best_found[ntry] = time_used;
-    time_total_run[ntry] = elapsed_time(VIRTUAL);
+    time_total_run[ntry] = elapsed_time( timer_type );
     
     if (best_so_far_ant->fitness < global_best_ant->fitness) {
         copy_from_to( best_so_far_ant, global_best_ant );
     }
         
-    if (log_file) fprintf(log_file,"end try %li \n",ntry);
+    if (log_file) {
+        fprintf(log_file,"workspace allocations %li, after the first iteration %li \n",
+                workspace_allocations, workspace_allocations - first_iteration_allocations);
+        fprintf(log_file,"%s construction: %li tours in %.2f seconds, %.1f tours/sec \n", 
+                step_major_flag ? "step-major" : "ant-major", n_tours, construction_time, 
+                n_tours / MAX(construction_time, 1e-9));
+        if ( ls_flag ) {
+            fprintf(log_file,"local search: %li ants in %.2f seconds \n", n_ls_ants, ls_time);
+        }
+        if ( packing_cache_size > 0 ) {
+            fprintf(log_file,"packing cache hits %li, misses %li, hit rate %.4f \n", packing_cache_hits, packing_cache_misses, 
+                    packing_cache_hits / (double) MAX(1, packing_cache_hits + packing_cache_misses));
+        }
+        fprintf(log_file,"end try %li \n",ntry);
+    }
 }
 
 void read_thop_instance(const char *input_file_name, struct point **nodeptr, struct item **itemptr)
@@ -292,7 +345,7 @@ void read_thop_instance(const char *input_file_name, struct point **nodeptr, str
     fscanf(input_file, "PROBLEM NAME: %s\n", buf);
     fscanf(input_file, "KNAPSACK DATA TYPE: %[^\n]\n", instance.knapsack_data_type);
     fscanf(input_file, "DIMENSION: %ld\n", &instance.n); ++instance.n;
-    assert(instance.n > 3 && instance.n < 6000);
+    assert(instance.n > 3);
     fscanf(input_file, "NUMBER OF ITEMS: %ld\n", &instance.m);
     fscanf(input_file, "CAPACITY OF KNAPSACK: %ld\n", &instance.capacity_of_knapsack);
     fscanf(input_file, "MAX TIME: %lf\n", &instance.max_time);
@@ -325,6 +378,31 @@ void read_thop_instance(const char *input_file_name, struct point **nodeptr, str
         }
     }
     
+    /* logarithms of profits and weights, used to score the items in compute_fitness */
+    instance.log_profit = (double *) malloc(instance.m * sizeof(double));
+    instance.log_weight = (double *) malloc(instance.m * sizeof(double));
+    for ( j = 0 ; j < instance.m ; j++ ) {
+        instance.log_profit[j] = log((double) (*itemptr)[j].profit);
+        instance.log_weight[j] = log((double) (*itemptr)[j].weight);
+    }
+    
+    /* compressed index from each city to its items */
+    instance.city_item_start = (long int *) calloc(instance.n + 1, sizeof(long int));
+    instance.city_items = (long int *) malloc(instance.m * sizeof(long int));
+    for ( j = 0 ; j < instance.m ; j++ ) {
+        instance.city_item_start[(*itemptr)[j].id_city + 1]++;
+    }
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        instance.city_item_start[i + 1] += instance.city_item_start[i];
+    }
+    for ( j = 0 ; j < instance.m ; j++ ) {
+        instance.city_items[instance.city_item_start[(*itemptr)[j].id_city]++] = j;
+    }
+    for ( i = instance.n ; i > 0 ; i-- ) {
+        instance.city_item_start[i] = instance.city_item_start[i - 1];
+    }
+    instance.city_item_start[0] = 0;
+    
     double *item_vector = (double *) malloc(instance.m * sizeof(double));
     double *help_vector = (double *) malloc(instance.m * sizeof(double));
     
@@ -368,6 +446,11 @@ void set_default_parameters(void)
 {
     ls_flag = 3; /* per default run 3-opt*/
     dlb_flag = TRUE; /* apply don't look bits in local search */
+    dlb_seed_flag = FALSE; /* search from all cities of a tour */
+    two_level_size = 5000; /* tours of at least 5000 cities are held in a two-level list */
+    ls_ants = 0; /* local search for all ants */
+    ls_diff = -1;
+    ls_budget_flag = FALSE;
     nn_ls = 20; /* use fixed radius search in the 20 nearest neighbours */
     n_ants = 25; /* number of ants */
     nn_ants = 20; /* number of nearest neighbours in tour construction */
@@ -378,6 +461,8 @@ void set_default_parameters(void)
     max_tries = 1;
     max_tours = 0;
     max_packing_tries = 1;
+    partial_sort_flag = TRUE;
+    n_threads = 1;
     seed = (long int) time(NULL);
     max_time = -1;
     optimal = 1;
@@ -389,8 +474,18 @@ void set_default_parameters(void)
     mmas_flag = TRUE;
     bwas_flag = FALSE;
     acs_flag = FALSE;
+    paco_flag = FALSE;
+    step_major_flag = FALSE;
+    incremental_flag = FALSE;
+    lazy_flag = FALSE;
+    sparse_flag = -1;
+    matrix_free_flag = -1;
+    compact_flag = TRUE;
+    kd_tree_flag = TRUE;
+    pow_ulps = 0.;
     ras_ranks = 0;
     elitist_ants = 0;
+    paco_size = 0;
 }
 
 void set_default_as_parameters(void) {
@@ -465,6 +560,19 @@ void set_default_acs_parameters(void) {
     elitist_ants = 0;
 }
 
+void set_default_paco_parameters(void) {
+    assert(paco_flag);
+    n_ants = 10; /* number of ants (-1 means instance size) */
+    nn_ants = 20; /* number of nearest neighbours in tour construction */
+    alpha = 1.0;
+    beta = 2.0;
+    rho = 0.1; /* only used for the trails of the nearest neighbour tour */
+    q_0 = 0.0;
+    ras_ranks = 0;
+    elitist_ants = 0;
+    paco_size = 5; /* number of tours in the archive */
+}
+
 void set_default_ls_parameters(void) {
     assert(ls_flag);
     dlb_flag = TRUE; /* apply don't look bits in local search */
@@ -493,30 +601,26 @@ void set_default_ls_parameters(void) {
 void save_best_thop_solution(void) 
 {
 
-    int i, first_print;
-    char *visited = (char *) calloc(instance.n, sizeof(char));
-    visited[0] = visited[instance.n - 2] = 1;
-
-    long int profit = 0.0;
+    int i, j, k, first_print;
+    long int city;
 
-    for (i = 0; i < instance.m; i++) {
-        if ( global_best_ant->packing_plan[i] ) {
-            visited[instance.itemptr[i].id_city] = 1;
-            profit += instance.itemptr[i].profit;
-        }
-    }
-    
     FILE *sol_file = fopen(output_name_buf, "w");
     
+    /* print the cities of the tour where at least one item is collected */
     first_print = TRUE;
     fprintf(sol_file, "[");
     for (i = 1; i < global_best_ant->tour_size - 3 ; i++) {
-        if ( visited[global_best_ant->tour[i]] ) {
+        city = global_best_ant->tour[i];
+        for (k = instance.city_item_start[city]; k < instance.city_item_start[city + 1]; k++) {
+            j = instance.city_items[k];
+            if ( global_best_ant->packing_plan[j] ) break;
+        }
+        if ( k < instance.city_item_start[city + 1] ) {
             if ( first_print == TRUE ) {
                 first_print = FALSE;
-                fprintf(sol_file, "%d", global_best_ant->tour[i] + 1);
+                fprintf(sol_file, "%ld", city + 1);
             }
-            else fprintf(sol_file, ",%d", global_best_ant->tour[i] + 1);
+            else fprintf(sol_file, ",%ld", city + 1);
         }
     }
     fprintf(sol_file, "]\n[");
@@ -532,7 +636,6 @@ void save_best_thop_solution(void)
         }
     }
     fprintf(sol_file, "]\n");
-    free(visited);
     
     fclose(sol_file);
 }
@@ -546,7 +649,7 @@ void write_report(void)
  */
 {
     if (log_file) {
-        fprintf(log_file, "best %10ld,        iteration: %10ld,        time %10.2f\n", instance.UB + 1 - best_so_far_ant->fitness, iteration, elapsed_time(VIRTUAL));
+        fprintf(log_file, "best %10ld,        iteration: %10ld,        time %10.2f\n", instance.UB + 1 - best_so_far_ant->fitness, iteration, elapsed_time( timer_type ));
         fflush(log_file);
     }
 }
@@ -566,6 +669,17 @@ void write_params(void)
         fprintf(log_file, "--tries              %ld\n", max_tries);
         fprintf(log_file, "--tours              %ld\n", max_tours);
         fprintf(log_file, "--ptries             %ld\n", max_packing_tries);    
+        fprintf(log_file, "--partialsort        %ld\n", partial_sort_flag);
+        fprintf(log_file, "--packingcache       %ld\n", packing_cache_size);
+        fprintf(log_file, "--threads            %ld\n", n_threads);
+        fprintf(log_file, "--stepmajor          %ld\n", step_major_flag);
+        fprintf(log_file, "--incremental        %ld\n", incremental_flag);
+        fprintf(log_file, "--lazy               %ld\n", lazy_flag);
+        fprintf(log_file, "--sparse             %ld\n", sparse_flag);
+        fprintf(log_file, "--matrixfree         %ld\n", matrix_free_flag);
+        fprintf(log_file, "--compact            %ld\n", compact_flag);
+        fprintf(log_file, "--kdtree             %ld\n", kd_tree_flag);
+        fprintf(log_file, "--powulps            %.2f\n", pow_ulps);
         fprintf(log_file, "--time               %.2f\n", max_time);
         fprintf(log_file, "--seed               %ld\n", seed);
         fprintf(log_file, "--optimum            %ld\n", optimal);
@@ -580,11 +694,18 @@ void write_params(void)
         fprintf(log_file, "--localsearch        %ld\n", ls_flag);
         fprintf(log_file, "--nnls               %ld\n", nn_ls);
         fprintf(log_file, "--dlb                %ld\n", dlb_flag);
+        fprintf(log_file, "--dlbseed            %ld\n", dlb_seed_flag);
+        fprintf(log_file, "--twolevel           %ld\n", two_level_size);
+        fprintf(log_file, "--lsants             %ld\n", ls_ants);
+        fprintf(log_file, "--lsdiff             %ld\n", ls_diff);
+        fprintf(log_file, "--lsbudget           %ld\n", ls_budget_flag);
         fprintf(log_file, "--as                 %ld\n", as_flag);
         fprintf(log_file, "--eas                %ld\n", eas_flag);
         fprintf(log_file, "--ras                %ld\n", ras_flag);
         fprintf(log_file, "--mmas               %ld\n", mmas_flag);
         fprintf(log_file, "--bwas               %ld\n", bwas_flag);
-        fprintf(log_file, "--acs                %ld\n\n", acs_flag);
+        fprintf(log_file, "--acs                %ld\n", acs_flag);
+        fprintf(log_file, "--paco               %ld\n", paco_flag);
+        fprintf(log_file, "--population         %ld\n\n", paco_size);
     }
 }
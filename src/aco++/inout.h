@@ -72,12 +72,18 @@ extern long int max_tours;    /* maximum number of tour constructions in one try
 
 extern long int max_packing_tries; /* number of tries to construct a good packing plan from a give tour */
 
+extern long int partial_sort_flag; /* = 1, sort the items of a packing try lazily, only as far as needed */
+
 extern double   lambda;       /* Parameter to determine branching factor */
 extern double   branch_fac;   /* If branching factor < branch_fac => update trails */
 
 extern double   max_time;     /* maximal allowed run time of a try  */
 extern double   time_used;    /* time used until some given event */
 extern double   time_passed;  /* time passed until some moment*/
+extern double   construction_time; /* time spent in the solution construction in the current try */
+extern double   ls_time;      /* time spent in the local search in the current try */
+extern long int n_ls_ants;    /* number of ants that underwent local search in the current try */
+extern long int first_iteration_allocations; /* workspace allocations done until the end of the first iteration */
 extern long int optimal;      /* optimal solution value or bound to find */
 
 extern double mean_ants;      /* average tour length */
@@ -121,6 +127,8 @@ void set_default_bwas_parameters(void);
 
 void set_default_acs_parameters(void);
 
+void set_default_paco_parameters(void);
+
 void set_default_ls_parameters(void);
 
 void save_best_thop_solution(void);
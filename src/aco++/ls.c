@@ -60,16 +60,298 @@
 #include "thop.h"
 #include "ants.h"
 #include "utilities.h"
+#include "twolevel.h"
 
 long int ls_flag;          /* indicates whether and which local search is used */ 
 long int nn_ls;            /* maximal depth of nearest neighbour lists used in the 
                               local search */ 
 long int dlb_flag = TRUE;  /* flag indicating whether don't look bits are used. I recommend 
                               to always use it if local search is applied */
+long int dlb_seed_flag = FALSE; /* = TRUE: only cities at arcs that are not in the reference 
+                              tour start with a cleared don't look bit */
+long int two_level_size = 5000; /* tours with at least this many cities are held in a two-level 
+                              list during 2-opt, Or-opt and 3-opt; 0: never */
+long int ls_ants = 0;      /* local search only for this many best ants of an iteration; 0: no limit */
+long int ls_diff = -1;     /* local search also for ants with more arcs than this that are not in 
+                              the restart-best tour; -1: never */
+long int ls_budget_flag = FALSE; /* = TRUE: the local search time per iteration is adapted */
+
+static int      *ref_succ;     /* successor and predecessor of each city in the reference tour */
+static int      *ref_pred;
+static unsigned int *ref_stamp; /* ref_succ[c] and ref_pred[c] are valid iff ref_stamp[c] == ref_epoch */
+static unsigned int ref_epoch;
+static long int ref_active = FALSE; /* = TRUE: a reference tour is set */
+
+struct ls_workspace {
+    int          *pos;            /* position of each city in the tour */
+    int          *dlb;            /* don't look bit of each city */
+    int          *random_vector;  /* cities of the tour in random order */
+    int          **nn_list;       /* candidate lists restricted to the cities of the tour */
+    int          *nn_count;       /* length of the candidate list of each city */
+    unsigned int *on_tour;        /* on_tour[c] == stamp iff city c is in the tour */
+    unsigned int stamp;
+    int          *h_tour;         /* help vectors for 3-opt exchanges and rotate_tour */
+    int          *hh_tour;
+    struct two_level_list list;   /* two-level list of long tours, if two_level_size > 0 */
+    double       nu;              /* packing-aware local search (ls_flag 5): loss of speed per unit of weight */
+    long int     route_size;      /* number of cities of route */
+    int          *route;          /* depot, cities in which items are picked up and final city, in tour order */
+    int          *route_index;    /* index of each city of route in route */
+    long int     *load;           /* weight carried when leaving each city of route */
+    double       *arrival;        /* arrival time at each city of route */
+    double       *slope;          /* prefix sums of distance * d(time)/d(weight) over the arcs of route */
+    double       *moment;         /* prefix sums of distance * weight * d(time)/d(weight) */
+    long int     *city_weight;    /* weight picked up in each city of the tour */
+    int          *items;          /* items of a city, by decreasing profit per weight */
+};
+
+/* access to the tour in either representation; L is NULL if the tour is kept in the array */
+#define POS( c )   ( L ? two_level_pos( L, c ) : pos[c] )
+#define SUCC( c )  ( L ? two_level_succ( L, c ) : tour[pos[c]+1] )
+#define PRED( c )  ( L ? two_level_pred( L, c ) : tour[pos[c] > 0 ? pos[c]-1 : n-1] )
+
+__thread struct ls_workspace *ls_ws;
+
+struct ls_workspace * allocate_ls_workspace( void )
+/*    
+      FUNCTION:       allocate the scratch arrays used by the local search
+      INPUT:          none
+      OUTPUT:         pointer to the workspace
+      COMMENTS:       all arrays are indexed by city or by tour position, hence have 
+                      (at most) instance.n entries and fit every tour
+ */
+{
+    struct ls_workspace *w;
+    long int i;
+
+    if ( (w = (struct ls_workspace *) workspace_malloc( sizeof(struct ls_workspace) )) == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    w->pos           = (int *) workspace_malloc( instance.n * sizeof(int) );
+    w->dlb           = (int *) workspace_malloc( instance.n * sizeof(int) );
+    w->random_vector = (int *) workspace_malloc( instance.n * sizeof(int) );
+    w->nn_list       = (int **) workspace_malloc( instance.n * sizeof(int *) + instance.n * nn_ls * sizeof(int) );
+    w->nn_count      = (int *) workspace_malloc( instance.n * sizeof(int) );
+    w->on_tour       = (unsigned int *) workspace_calloc( instance.n, sizeof(unsigned int) );
+    w->stamp         = 0;
+    w->h_tour        = (int *) workspace_malloc( instance.n * sizeof(int) );
+    w->hh_tour       = (int *) workspace_malloc( instance.n * sizeof(int) );
+    if ( w->pos == NULL || w->dlb == NULL || w->random_vector == NULL || w->nn_list == NULL ||
+         w->nn_count == NULL || w->on_tour == NULL || w->h_tour == NULL || w->hh_tour == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < instance.n ; i++ )
+        w->nn_list[i] = (int *)(w->nn_list + instance.n) + i * nn_ls;
+    if ( two_level_size > 0 )
+        two_level_allocate( &w->list, instance.n );
+    if ( ls_flag == 5 ) {
+        w->route       = (int *) workspace_malloc( instance.n * sizeof(int) );
+        w->route_index = (int *) workspace_malloc( instance.n * sizeof(int) );
+        w->load        = (long int *) workspace_malloc( instance.n * sizeof(long int) );
+        w->arrival     = (double *) workspace_malloc( instance.n * sizeof(double) );
+        w->slope       = (double *) workspace_malloc( instance.n * sizeof(double) );
+        w->moment      = (double *) workspace_malloc( instance.n * sizeof(double) );
+        w->city_weight = (long int *) workspace_malloc( instance.n * sizeof(long int) );
+        w->items       = (int *) workspace_malloc( instance.m * sizeof(int) );
+        if ( w->route == NULL || w->route_index == NULL || w->load == NULL || w->arrival == NULL ||
+             w->slope == NULL || w->moment == NULL || w->city_weight == NULL || w->items == NULL ) {
+            fprintf(stderr,"Out of memory, exit.");
+            exit(1);
+        }
+    }
+    return w;
+}
+
+void free_ls_workspace( struct ls_workspace *w )
+/*    
+      FUNCTION:       free the scratch arrays used by the local search
+      INPUT:          pointer to the workspace, may be NULL
+      OUTPUT:         none
+ */
+{
+    if ( w == NULL )
+        return;
+    free( w->pos );
+    free( w->dlb );
+    free( w->random_vector );
+    free( w->nn_list );
+    free( w->nn_count );
+    free( w->on_tour );
+    free( w->h_tour );
+    free( w->hh_tour );
+    if ( two_level_size > 0 )
+        two_level_free( &w->list );
+    if ( ls_flag == 5 ) {
+        free( w->route );
+        free( w->route_index );
+        free( w->load );
+        free( w->arrival );
+        free( w->slope );
+        free( w->moment );
+        free( w->city_weight );
+        free( w->items );
+    }
+    free( w );
+}
+
+void set_ls_reference( const int *tour, long int t_size )
+/*    
+      FUNCTION:       set the reference tour used to seed the don't look bits
+      INPUT:          reference tour and its size (including the closing city), or NULL 
+                      to search all cities again
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the following local searches only start from cities at arcs that 
+                      are not in the reference tour
+      COMMENTS:       must not be called while local searches are running
+ */
+{
+    long int i, a, b;
 
-void rotate_tour( long int *tour, long int n ) {
+    if ( tour == NULL ) {
+        ref_active = FALSE;
+        return;
+    }
+    if ( ref_epoch == UINT_MAX ) {
+        for ( i = 0 ; i < instance.n ; i++ )
+            ref_stamp[i] = 0;
+        ref_epoch = 0;
+    }
+    ref_epoch++;
+    for ( i = 0 ; i < t_size - 1 ; i++ ) {
+        a = tour[i];
+        b = tour[i+1];
+        ref_succ[a] = b;
+        ref_pred[b] = a;
+        ref_stamp[a] = ref_epoch;
+    }
+    ref_active = TRUE;
+}
+
+void allocate_ls_reference( void )
+/*    
+      FUNCTION:       allocate the index of the reference tour
+      INPUT:          none
+      OUTPUT:         none
+ */
+{
+    ref_succ  = (int *) workspace_malloc( instance.n * sizeof(int) );
+    ref_pred  = (int *) workspace_malloc( instance.n * sizeof(int) );
+    ref_stamp = (unsigned int *) workspace_calloc( instance.n, sizeof(unsigned int) );
+    if ( ref_succ == NULL || ref_pred == NULL || ref_stamp == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    ref_epoch = 0;
+}
 
-    int pos_0, i, j, k, ini, fin, tmp;
+void free_ls_reference( void )
+/*    
+      FUNCTION:       free the index of the reference tour
+      INPUT:          none
+      OUTPUT:         none
+ */
+{
+    free( ref_succ );
+    free( ref_pred );
+    free( ref_stamp );
+    ref_stamp = NULL;
+    ref_active = FALSE;
+}
+
+static long int reference_arc( long int a, long int b )
+/*    
+      FUNCTION:       check whether the arc (a,b) is in the reference tour
+      INPUT:          two cities
+      OUTPUT:         TRUE if a and b are neighbours in the reference tour, else FALSE
+ */
+{
+    return ref_stamp[a] == ref_epoch && ( ref_succ[a] == b || ref_pred[a] == b );
+}
+
+static struct two_level_list * prepare_ls_workspace( struct ls_workspace *w, const int *tour, 
+                                                     long int n )
+/*    
+      FUNCTION:       set up the workspace for the local search of a tour
+      INPUT:          workspace, tour and number n of its cities (without the closing city)
+      OUTPUT:         the two-level list that holds the tour if it has at least 
+                      two_level_size cities, else NULL
+      (SIDE)EFFECTS:  positions, don't look bits and candidate lists of the cities of the 
+                      tour are set, random_vector holds these cities in random order
+      COMMENTS:       the candidate list of a city holds the first nn_ls cities of its nearest 
+                      neighbour list that are in the tour. Membership is marked with a stamp, 
+                      so only the n cities of the tour are touched. If a reference tour is 
+                      set, only the don't look bits of the cities at new arcs are cleared. 
+                      Once a two-level list is returned, pos is not kept up to date; the 
+                      search writes the list back into the tour when it ends
+ */
+{
+    long int  i, h, k, c, c2, help, node;
+    int       *nn;
+
+    if ( w->stamp == UINT_MAX ) {
+        for ( i = 0 ; i < instance.n ; i++ )
+            w->on_tour[i] = 0;
+        w->stamp = 0;
+    }
+    w->stamp++;
+    for ( i = 0 ; i < n ; i++ ) {
+        c = tour[i];
+        w->pos[c] = i;
+        w->dlb[c] = FALSE;
+        w->on_tour[c] = w->stamp;
+    }
+    if ( ref_active ) {
+        /* cities whose arcs are all in the reference tour are not searched */
+        for ( i = 0 ; i < n ; i++ )
+            w->dlb[tour[i]] = TRUE;
+        for ( i = 0 ; i < n ; i++ ) {
+            if ( !reference_arc( tour[i], tour[i+1] ) ) {
+                w->dlb[tour[i]] = FALSE;
+                w->dlb[tour[i+1]] = FALSE;
+            }
+        }
+    }
+    for ( i = 0 ; i < n ; i++ ) {
+        c = tour[i];
+        nn = instance.nn_list[c];
+        for ( h = 0, k = 0 ; h < instance.n_near && k < nn_ls ; h++ ) {
+            c2 = nn[h];
+            if ( w->on_tour[c2] == w->stamp )
+                w->nn_list[c][k++] = c2;
+        }
+        w->nn_count[c] = k;
+    }
+
+    /* random order of the cities, drawn as in the original random permutation */
+    for ( i = 0 ; i < n ; i++ )
+        w->random_vector[i] = tour[i];
+    for ( i = 0 ; i < n ; i++ ) {
+        node = (long int) (rng_ran01( &rng ) * (n - i));
+        DEBUG ( assert( i + node < n ); )
+        help = w->random_vector[i];
+        w->random_vector[i] = w->random_vector[i+node];
+        w->random_vector[i+node] = help;
+    }
+
+    if ( two_level_size > 0 && n >= two_level_size ) {
+        two_level_build( &w->list, tour, n );
+        return &w->list;
+    }
+    return NULL;
+}
+
+static void rotate_tour( int *tour, long int n, int *cp_tour )
+/*    
+      FUNCTION:       rotate (and possibly reverse) a tour such that it starts with city 0 
+                      and the dummy city instance.n-1 is its last city
+      INPUT:          tour, number n of its cities and a help vector of length n
+      OUTPUT:         none
+ */
+{
+
+    int pos_0, i, k, ini, fin, tmp;
     for ( pos_0 = 1 ; pos_0 < n ; pos_0++ ) if ( tour[pos_0] == 0 ) break;
 
     if ( tour[pos_0 - 1] != instance.n - 1 ) {
@@ -89,121 +371,76 @@ void rotate_tour( long int *tour, long int n ) {
         }
     }
     else {
-        long int *cp_tour = (long int *) calloc(n, sizeof(long int));
         for ( i = 0 ; i < n ; i++ ) cp_tour[i] = tour[i];
         for ( k = 0, i = pos_0 ; i < n ; i++, k++) tour[k] = cp_tour[i];
         for ( i = 0 ; i < pos_0 ; i++, k++) tour[k] = cp_tour[i];
-        free ( cp_tour );
     }
 }
 
-long int** compute_local_distances( long int *tour, long int n )
+static void two_opt_move( int *tour, int *pos, struct two_level_list *L, long int n, 
+                          long int h1, long int h2, long int h3, long int h4 )
 /*    
-      FUNCTION: computes the matrix of all intercity distances
-      INPUT:    none
-      OUTPUT:   pointer to distance matrix, has to be freed when program stops
+      FUNCTION:       replace the arcs (h1,h2) and (h3,h4) by (h1,h3) and (h2,h4)
+      INPUT:          tour, positions of its cities, two-level list (or NULL), number n of 
+                      cities, the cities of the move; h2 is the successor of h1 and h4 the 
+                      one of h3
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the shorter of the two tour parts is reversed
  */
 {
-    long int     i, j;
-    long int     **matrix;
+    long int i, j, h, c1, c2, help;
 
-    if((matrix = (long int **) malloc(sizeof(long int) * n * n + sizeof(long int *) * n)) == NULL){
-        fprintf(stderr,"Out of memory, exit.");
-        exit(1);
-    }
-    for ( i = 0 ; i < n ; i++ ) {
-        matrix[i] = (long int *)(matrix + n) + i * n;
+    if ( POS(h3) < POS(h1) ) {
+        help = h1; h1 = h3; h3 = help;
+        help = h2; h2 = h4; h4 = help;
     }
-
-    for ( i = 0 ; i < n ; i++ ) {
-        for ( j = 0 ; j < n ; j++ ) { 
-            matrix[i][j] = instance.distance[tour[i]][tour[j]];
+    if ( POS(h3) - POS(h2) < n / 2 + 1) {
+        /* reverse inner part from pos[h2] to pos[h3] */
+        if ( L ) {
+            two_level_reverse( L, h2, h3 );
+            return;
+        }
+        i = pos[h2]; j = pos[h3];
+        while (i < j) {
+            c1 = tour[i];
+            c2 = tour[j];
+            tour[i] = c2;
+            tour[j] = c1;
+            pos[c1] = j;
+            pos[c2] = i;
+            i++; j--;
         }
     }
-
-    return matrix;
-}
-
-long int** compute_local_nn_lists( long int **distance, long int n )
-/*    
-      FUNCTION: computes nearest neighbor lists of depth nn for each city
-      INPUT:    none
-      OUTPUT:   pointer to the nearest neighbor lists
- */
-{
-    long int i, node, nn;
-    long int *distance_vector;
-    long int *help_vector;
-    long int **m_nnear;
-
-    TRACE ( printf("\n computing nearest neighbor lists, "); )
-
-    nn = MAX(nn_ls,nn_ants);
-    if ( nn >= n )
-        nn = n - 1;
-    DEBUG ( assert( n > nn ); )
-
-    TRACE ( printf("nn = %ld ... \n",nn); )
-
-    if((m_nnear = (long int **) malloc(sizeof(long int) * n * nn + n * sizeof(long int *))) == NULL){
-        exit(EXIT_FAILURE);
-    }
-    distance_vector = (long int *) calloc(n, sizeof(long int));
-    help_vector = (long int *) calloc(n, sizeof(long int));
-
-    for ( node = 0 ; node < n ; node++ ) {  /* compute cnd-sets for all node */
-        m_nnear[node] = (long int *)(m_nnear + n) + node * nn;
-        for ( i = 0 ; i < n ; i++ ) {  /* Copy distances from nodes to the others */
-            distance_vector[i] = distance[node][i];
-            help_vector[i] = i;
+    else {
+        /* reverse outer part from pos[h4] to pos[h1] */
+        if ( L ) {
+            two_level_reverse( L, h4, h1 );
+            return;
         }
-        distance_vector[node] = LONG_MAX;  /* city is not nearest neighbour */
-        sort2(distance_vector, help_vector, 0, n - 1);
-        for ( i = 0 ; i < nn ; i++ ) {
-            m_nnear[node][i] = help_vector[i];
+        i = pos[h1]; j = pos[h4];
+        if ( j > i )
+            help = n - (j - i) + 1;
+        else
+            help = (i - j) + 1;
+        help = help / 2;
+        for ( h = 0 ; h < help ; h++ ) {
+            c1 = tour[i];
+            c2 = tour[j];
+            tour[i] = c2;
+            tour[j] = c1;
+            pos[c1] = j;
+            pos[c2] = i;
+            i--; j++;
+            if ( i < 0 )
+                i = n-1;
+            if ( j >= n )
+                j = 0;
         }
     }
-    free(distance_vector);
-    free(help_vector);
-    TRACE ( printf("\n    .. done\n"); )
-
-    return m_nnear;
-}
-
-
-long int * generate_random_permutation( long int n )
-/*    
-      FUNCTION:       generate a random permutation of the integers 0 .. n-1
-      INPUT:          length of the array
-      OUTPUT:         pointer to the random permutation
-      (SIDE)EFFECTS:  the array holding the random permutation is allocated in this 
-                      function. Don't forget to free again the memory!
-      COMMENTS:       only needed by the local search procedures
- */
-{
-    long int  i, help, node, tot_assigned = 0;
-    double    rnd;
-    long int  *r;
-
-    r = (long int *) malloc(n * sizeof(long int));
-
-    for ( i = 0 ; i < n; i++)
-        r[i] = i;
-
-    for ( i = 0 ; i < n ; i++ ) {
-        /* find (randomly) an index for a free unit */
-        rnd  = ran01 ( &seed );
-        node = (long int) (rnd  * (n - tot_assigned));
-        assert( i + node < n );
-        help = r[i];
-        r[i] = r[i+node];
-        r[i+node] = help;
-        tot_assigned++;
-    }
-    return r;
+    tour[n] = tour[0];
 }
 
-void two_opt_first( long int *tour, long int t_size ) 
+void two_opt_first( int *tour, long int t_size ) 
 /*    
       FUNCTION:       2-opt a tour 
       INPUT:          pointer to the tour that undergoes local optimization
@@ -221,39 +458,32 @@ void two_opt_first( long int *tour, long int t_size )
 
     long int n = (long int) (t_size - 1);
 
-    long int i, j, h, l, nn, local_nn_ls;
+    long int h, l;
     
-    long int  **distance = compute_local_distances(tour, n);
-
-    long int  **nn_list = compute_local_nn_lists(distance, n);
-
-    long int *original_tour = (long int *) malloc(n * sizeof(long int));
-
-    for ( i = 0 ; i < n ; i++ ) { original_tour[i] = tour[i]; tour[i] = i; }
-
-    local_nn_ls = MIN(n - 1, nn_ls);
+    struct ls_workspace *w = ls_ws;
 
     long int c1, c2;             /* cities considered for an exchange */
     long int s_c1, s_c2;         /* successor cities of c1 and c2     */
     long int p_c1, p_c2;         /* predecessor cities of c1 and c2   */
-    long int pos_c1, pos_c2;     /* positions of cities c1, c2        */
-    long int improvement_flag, help, n_improves = 0, n_exchanges=0;
+    long int improvement_flag, n_improves = 0, n_exchanges=0;
     long int h1=0, h2=0, h3=0, h4=0;
     long int radius;             /* radius of nn-search */
     long int gain = 0;
-    long int *random_vector;
-    long int *pos;               /* positions of cities in tour */
-    long int *dlb;               /* vector containing don't look bits */
-
-    pos = (long int *) malloc(n * sizeof(long int));
-    dlb = (long int *) malloc(n * sizeof(long int));
-    for ( i = 0 ; i < n ; i++ ) {
-        pos[tour[i]] = i;
-        dlb[i] = FALSE;
-    }
+    int      *random_vector;
+    int      *pos;               /* positions of cities in tour */
+    int      *dlb;               /* vector containing don't look bits */
+    int      **nn_list;          /* candidate lists of the cities in the tour */
+    int      *nn_count;          /* lengths of the candidate lists */
+    struct two_level_list *L;    /* two-level list of a long tour, else NULL */
+
+    L = prepare_ls_workspace( w, tour, n );
+    pos = w->pos;
+    dlb = w->dlb;
+    nn_list = w->nn_list;
+    nn_count = w->nn_count;
+    random_vector = w->random_vector;
 
     improvement_flag = TRUE;
-    random_vector = generate_random_permutation( n );
 
     while ( improvement_flag ) {
 
@@ -262,20 +492,19 @@ void two_opt_first( long int *tour, long int t_size )
         for (l = 0 ; l < n; l++) {
 
             c1 = random_vector[l];
-            DEBUG ( assert ( c1 < n && c1 >= 0); )
+            DEBUG ( assert ( c1 < instance.n && c1 >= 0); )
             if ( dlb_flag && dlb[c1] )
                 continue;
-            pos_c1 = pos[c1];
-            s_c1 = tour[pos_c1+1];
-            radius = distance[c1][s_c1];
+            s_c1 = SUCC(c1);
+            radius = instance_distance(c1, s_c1);
 
             /* First search for c1's nearest neighbours, use successor of c1 */
-            for ( h = 0 ; h < local_nn_ls ; h++ ) {
+            for ( h = 0 ; h < nn_count[c1] ; h++ ) {
                 c2 = nn_list[c1][h]; /* exchange partner, determine its position */
-                if ( radius > distance[c1][c2] ) {
-                    s_c2 = tour[pos[c2]+1];
-                    gain =  - radius + distance[c1][c2] +
-                            distance[s_c1][s_c2] - distance[c2][s_c2];
+                if ( radius > instance_distance(c1, c2) ) {
+                    s_c2 = SUCC(c2);
+                    gain =  - radius + instance_distance(c1, c2) +
+                            instance_distance(s_c1, s_c2) - instance_distance(c2, s_c2);
                     if ( gain < 0 ) {
                         h1 = c1; h2 = s_c1; h3 = c2; h4 = s_c2;
                         goto exchange2opt;
@@ -285,25 +514,18 @@ void two_opt_first( long int *tour, long int t_size )
                     break;
             }
             /* Search one for next c1's h-nearest neighbours, use predecessor c1 */
-            if (pos_c1 > 0)
-                p_c1 = tour[pos_c1-1];
-            else
-                p_c1 = tour[n-1];
-            radius = distance[p_c1][c1];
-            for ( h = 0 ; h < local_nn_ls ; h++ ) {
+            p_c1 = PRED(c1);
+            radius = instance_distance(p_c1, c1);
+            for ( h = 0 ; h < nn_count[c1] ; h++ ) {
                 c2 = nn_list[c1][h];  /* exchange partner, determine its position */
-                if ( radius > distance[c1][c2] ) {
-                    pos_c2 = pos[c2];
-                    if (pos_c2 > 0)
-                        p_c2 = tour[pos_c2-1];
-                    else
-                        p_c2 = tour[n-1];
+                if ( radius > instance_distance(c1, c2) ) {
+                    p_c2 = PRED(c2);
                     if ( p_c2 == c1 )
                         continue;
                     if ( p_c1 == c2 )
                         continue;
-                    gain =  - radius + distance[c1][c2] +
-                            distance[p_c1][p_c2] - distance[p_c2][c2];
+                    gain =  - radius + instance_distance(c1, c2) +
+                            instance_distance(p_c1, p_c2) - instance_distance(p_c2, c2);
                     if ( gain < 0 ) {
                         h1 = p_c1; h2 = c1; h3 = p_c2; h4 = c2;
                         goto exchange2opt;
@@ -321,67 +543,21 @@ void two_opt_first( long int *tour, long int t_size )
             improvement_flag = TRUE;
             dlb[h1] = FALSE; dlb[h2] = FALSE;
             dlb[h3] = FALSE; dlb[h4] = FALSE;
-            /* Now perform move */
-            if ( pos[h3] < pos[h1] ) {
-                help = h1; h1 = h3; h3 = help;
-                help = h2; h2 = h4; h4 = help;
-            }
-            if ( pos[h3] - pos[h2] < n / 2 + 1) {
-                /* reverse inner part from pos[h2] to pos[h3] */
-                i = pos[h2]; j = pos[h3];
-                while (i < j) {
-                    c1 = tour[i];
-                    c2 = tour[j];
-                    tour[i] = c2;
-                    tour[j] = c1;
-                    pos[c1] = j;
-                    pos[c2] = i;
-                    i++; j--;
-                }
-            }
-            else {
-                /* reverse outer part from pos[h4] to pos[h1] */
-                i = pos[h1]; j = pos[h4];
-                if ( j > i )
-                    help = n - (j - i) + 1;
-                else
-                    help = (i - j) + 1;
-                help = help / 2;
-                for ( h = 0 ; h < help ; h++ ) {
-                    c1 = tour[i];
-                    c2 = tour[j];
-                    tour[i] = c2;
-                    tour[j] = c1;
-                    pos[c1] = j;
-                    pos[c2] = i;
-                    i--; j++;
-                    if ( i < 0 )
-                        i = n-1;
-                    if ( j >= n )
-                        j = 0;
-                }
-                tour[n] = tour[0];
-            }
+            two_opt_move( tour, pos, L, n, h1, h2, h3, h4 );
         }
         if ( improvement_flag ) {
             n_improves++;
         }
     }
 
-    for ( i = 0 ; i < n ; i++ ) tour[i] = original_tour[tour[i]];
-    
-    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n);
+    if ( L )
+        two_level_to_tour( L, tour );
+    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n, w->h_tour);
     tour[n] = tour[0];
     
-    free( random_vector );
-    free( dlb );
-    free( pos );
-    free( distance );
-    free( nn_list );
-    free( original_tour);
 }
 
-void two_h_opt_first( long int *tour, long int t_size ) 
+void two_h_opt_first( int *tour, long int t_size ) 
 /*    
       FUNCTION:       2-h-opt a tour
       INPUT:          pointer to the tour that undergoes local optimization
@@ -402,15 +578,9 @@ void two_h_opt_first( long int *tour, long int t_size )
 
     long int n = (long int) (t_size - 1);
     
-    long int i, j, h, l, nn, local_nn_ls;
+    long int i, j, h, l;
     
-    long int  **distance = compute_local_distances(tour, n);
-
-    long int  **nn_list = compute_local_nn_lists(distance, n);
-
-    long int *original_tour = (long int *) malloc(n * sizeof(long int));
-
-    for ( i = 0 ; i < n ; i++ ) { original_tour[i] = tour[i]; tour[i] = i; }
+    struct ls_workspace *w = ls_ws;
 
     long int c1, c2;         /* cities considered for an exchange */
     long int s_c1, s_c2;     /* successors of c1 and c2           */
@@ -420,21 +590,22 @@ void two_h_opt_first( long int *tour, long int t_size )
     long int h1=0, h2=0, h3=0, h4=0, h5=0, help;
     long int radius;             /* radius of nn-search */
     long int gain = 0;
-    long int *random_vector;
+    int      *random_vector;
     long int two_move, node_move;
 
-    long int *pos;               /* positions of cities in tour */
-    long int *dlb;               /* vector containing don't look bits */
+    int      *pos;               /* positions of cities in tour */
+    int      *dlb;               /* vector containing don't look bits */
+    int      **nn_list;          /* candidate lists of the cities in the tour */
+    int      *nn_count;          /* lengths of the candidate lists */
 
-    pos = (long int *) malloc(n * sizeof(long int));
-    dlb = (long int *) malloc(n * sizeof(long int));
-    for ( i = 0 ; i < n ; i++ ) {
-        pos[tour[i]] = i;
-        dlb[i] = FALSE;
-    }
+    prepare_ls_workspace( w, tour, n );
+    pos = w->pos;
+    dlb = w->dlb;
+    nn_list = w->nn_list;
+    nn_count = w->nn_count;
+    random_vector = w->random_vector;
 
     improvement_flag = TRUE;
-    random_vector = generate_random_permutation( n );
 
     while ( improvement_flag ) {
 
@@ -443,22 +614,22 @@ void two_h_opt_first( long int *tour, long int t_size )
         for (l = 0 ; l < n; l++) {
 
             c1 = random_vector[l];
-            DEBUG ( assert ( c1 < n && c1 >= 0); )
+            DEBUG ( assert ( c1 < instance.n && c1 >= 0); )
             if ( dlb_flag && dlb[c1] )
                 continue;
             improve_node = FALSE;
             pos_c1 = pos[c1];
             s_c1 = tour[pos_c1+1];
-            radius = distance[c1][s_c1];
+            radius = instance_distance(c1, s_c1);
 
             /* First search for c1's nearest neighbours, use successor of c1 */
-            for ( h = 0 ; h < local_nn_ls ; h++ ) {
+            for ( h = 0 ; h < nn_count[c1] ; h++ ) {
                 c2 = nn_list[c1][h]; /* exchange partner, determine its position */
-                if ( radius > distance[c1][c2] ) {
+                if ( radius > instance_distance(c1, c2) ) {
                     pos_c2 = pos[c2];
                     s_c2 = tour[pos_c2+1];
-                    gain =  - radius + distance[c1][c2] +
-                            distance[s_c1][s_c2] - distance[c2][s_c2];
+                    gain =  - radius + instance_distance(c1, c2) +
+                            instance_distance(s_c1, s_c2) - instance_distance(c2, s_c2);
                     if ( gain < 0 ) {
                         h1 = c1; h2 = s_c1; h3 = c2; h4 = s_c2;
                         improve_node = TRUE; two_move = TRUE; node_move = FALSE;
@@ -468,9 +639,9 @@ void two_h_opt_first( long int *tour, long int t_size )
                         p_c2 = tour[pos_c2-1];
                     else
                         p_c2 = tour[n-1];
-                    gain = - radius + distance[c1][c2] + distance[c2][s_c1]
-                                                                                        + distance[p_c2][s_c2] - distance[c2][s_c2]
-                                                                                                                                                - distance[p_c2][c2];
+                    gain = - radius + instance_distance(c1, c2) + instance_distance(c2, s_c1)
+                                                                                        + instance_distance(p_c2, s_c2) - instance_distance(c2, s_c2)
+                                                                                                                                                - instance_distance(p_c2, c2);
                     if ( c2 == s_c1 )
                         gain = 0;
                     if ( p_c2 == s_c1 )
@@ -492,10 +663,10 @@ void two_h_opt_first( long int *tour, long int t_size )
                 p_c1 = tour[pos_c1-1];
             else
                 p_c1 = tour[n-1];
-            radius = distance[p_c1][c1];
-            for ( h = 0 ; h < local_nn_ls ; h++ ) {
+            radius = instance_distance(p_c1, c1);
+            for ( h = 0 ; h < nn_count[c1] ; h++ ) {
                 c2 = nn_list[c1][h];  /* exchange partner, determine its position */
-                if ( radius > distance[c1][c2] ) {
+                if ( radius > instance_distance(c1, c2) ) {
                     pos_c2 = pos[c2];
                     if (pos_c2 > 0)
                         p_c2 = tour[pos_c2-1];
@@ -505,17 +676,17 @@ void two_h_opt_first( long int *tour, long int t_size )
                         continue;
                     if ( p_c1 == c2 )
                         continue;
-                    gain =  - radius + distance[c1][c2] +
-                            distance[p_c1][p_c2] - distance[p_c2][c2];
+                    gain =  - radius + instance_distance(c1, c2) +
+                            instance_distance(p_c1, p_c2) - instance_distance(p_c2, c2);
                     if ( gain < 0 ) {
                         h1 = p_c1; h2 = c1; h3 = p_c2; h4 = c2;
                         improve_node = TRUE; two_move = TRUE; node_move = FALSE;
                         goto exchange;
                     }
                     s_c2 = tour[pos[c2]+1];
-                    gain = - radius + distance[c2][c1] + distance[p_c1][c2]
-                                                                                          + distance[p_c2][s_c2] - distance[c2][s_c2]
-                                                                                                                                                  - distance[p_c2][c2];
+                    gain = - radius + instance_distance(c2, c1) + instance_distance(p_c1, c2)
+                                                                                          + instance_distance(p_c2, s_c2) - instance_distance(c2, s_c2)
+                                                                                                                                                  - instance_distance(p_c2, c2);
                     if ( p_c1 == c2 )
                         gain = 0;
                     if ( p_c1 == s_c2 )
@@ -622,20 +793,310 @@ void two_h_opt_first( long int *tour, long int t_size )
         }
     }
     
-    for ( i = 0 ; i < n ; i++ ) tour[i] = original_tour[tour[i]];
+    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n, w->h_tour);
+    tour[n] = tour[0];
     
-    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n);
+}
+
+static void move_segment( int *tour, int *pos, struct two_level_list *L, long int n, 
+                          long int first, long int last, long int len, long int x, long int reversed )
+/*    
+      FUNCTION:       move a segment of the tour between city x and its successor
+      INPUT:          tour, positions of its cities, two-level list (or NULL), number n of 
+                      cities, first and last city and length (at most OR_OPT_SEGMENT) of the 
+                      segment, city x that is not in the segment, and whether the segment 
+                      is inserted in reverse order
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the cities between the segment and its new place are shifted by len 
+                      positions; the shorter of the two ways around the tour is used
+ */
+{
+    long int k, p, q, c, dst, start, fwd, bwd;
+    int      seg[OR_OPT_SEGMENT];
+
+    p = POS(first);
+    q = POS(x);
+    fwd = (q - p - len + 1 + 2 * n) % n;   /* cities from the successor of the segment to x */
+    bwd = (p - q - 1 + 2 * n) % n;         /* cities from the successor of x to the predecessor of the segment */
+    if ( L ) {
+        if ( fwd <= bwd )
+            two_level_rearrange( L, first, last, x, TRUE, reversed, FALSE );
+        else if ( bwd > 0 )
+            two_level_rearrange( L, two_level_succ( L, x ), two_level_pred( L, first ), last, 
+                                 TRUE, FALSE, reversed );
+        else if ( reversed )
+            two_level_reverse( L, first, last );
+        return;
+    }
+    for ( k = 0 ; k < len ; k++ )
+        seg[reversed ? len - 1 - k : k] = tour[(p + k) % n];
+    if ( fwd <= bwd ) {
+        for ( k = 0 ; k < fwd ; k++ ) {
+            c = tour[(p + len + k) % n];
+            dst = (p + k) % n;
+            tour[dst] = c;
+            pos[c] = dst;
+        }
+        start = (p + fwd) % n;
+    }
+    else {
+        for ( k = 0 ; k < bwd ; k++ ) {
+            c = tour[(p - 1 - k + n) % n];
+            dst = (p + len - 1 - k + n) % n;
+            tour[dst] = c;
+            pos[c] = dst;
+        }
+        start = (q + 1) % n;
+    }
+    for ( k = 0 ; k < len ; k++ ) {
+        dst = (start + k) % n;
+        tour[dst] = seg[k];
+        pos[seg[k]] = dst;
+    }
     tour[n] = tour[0];
+}
+
+void or_opt_first( int *tour, long int t_size ) 
+/*    
+      FUNCTION:       2-opt a tour and move segments of up to OR_OPT_SEGMENT cities (Or-opt)
+      INPUT:          pointer to the tour that undergoes local optimization
+      OUTPUT:         none
+      (SIDE)EFFECTS:  tour is 2-opt and Or-opt
+      COMMENTS:       for each city c1, first the 2-opt moves as in two_opt_first are 
+                      tried, then the segments that start at c1 are moved next to a 
+                      candidate c2 of c1, in either orientation such that c1 becomes a 
+                      neighbour of c2. The removal gain of the segment serves as radius 
+                      of the candidate search. The neighbourhood is scanned in random 
+                      order and the first improving move is applied
+ */
+{
+    long int n = (long int) (t_size - 1);
+    
+    long int h, l, len;
     
-    free( random_vector );
-    free( dlb );
-    free( pos );
-    free( distance );
-    free( nn_list );
-    free( original_tour);
+    struct ls_workspace *w = ls_ws;
+
+    long int c1, c2;             /* cities considered for an exchange */
+    long int s_c1, s_c2;         /* successor cities of c1 and c2     */
+    long int p_c1, p_c2;         /* predecessor cities of c1 and c2   */
+    long int pos_c1, pos_c2;     /* positions of cities c1, c2        */
+    long int seg_last, seg_pred, seg_succ; /* last city of the segment, cities before and after it */
+    long int improvement_flag;
+    long int h1=0, h2=0, h3=0, h4=0;
+    long int radius;             /* radius of nn-search */
+    long int gain = 0, removal;
+    long int or_x = 0, or_len = 0, or_reversed = FALSE; /* Or-opt move that is applied */
+    int      *random_vector;
+    int      *pos;               /* positions of cities in tour */
+    int      *dlb;               /* vector containing don't look bits */
+    int      **nn_list;          /* candidate lists of the cities in the tour */
+    int      *nn_count;          /* lengths of the candidate lists */
+    struct two_level_list *L;    /* two-level list of a long tour, else NULL */
+
+    L = prepare_ls_workspace( w, tour, n );
+    pos = w->pos;
+    dlb = w->dlb;
+    nn_list = w->nn_list;
+    nn_count = w->nn_count;
+    random_vector = w->random_vector;
+
+    improvement_flag = TRUE;
+
+    while ( improvement_flag ) {
+
+        improvement_flag = FALSE;
+
+        for (l = 0 ; l < n; l++) {
+
+            c1 = random_vector[l];
+            DEBUG ( assert ( c1 < instance.n && c1 >= 0); )
+            if ( dlb_flag && dlb[c1] )
+                continue;
+            pos_c1 = POS(c1);
+            s_c1 = SUCC(c1);
+            p_c1 = PRED(c1);
+
+            /* 2-opt moves with the successor of c1 */
+            radius = instance_distance(c1, s_c1);
+            for ( h = 0 ; h < nn_count[c1] ; h++ ) {
+                c2 = nn_list[c1][h];
+                if ( radius > instance_distance(c1, c2) ) {
+                    s_c2 = SUCC(c2);
+                    gain =  - radius + instance_distance(c1, c2) +
+                            instance_distance(s_c1, s_c2) - instance_distance(c2, s_c2);
+                    if ( gain < 0 ) {
+                        h1 = c1; h2 = s_c1; h3 = c2; h4 = s_c2;
+                        goto exchange2opt;
+                    }
+                }
+                else
+                    break;
+            }
+            /* 2-opt moves with the predecessor of c1 */
+            radius = instance_distance(p_c1, c1);
+            for ( h = 0 ; h < nn_count[c1] ; h++ ) {
+                c2 = nn_list[c1][h];
+                if ( radius > instance_distance(c1, c2) ) {
+                    p_c2 = PRED(c2);
+                    if ( p_c2 == c1 || p_c1 == c2 )
+                        continue;
+                    gain =  - radius + instance_distance(c1, c2) +
+                            instance_distance(p_c1, p_c2) - instance_distance(p_c2, c2);
+                    if ( gain < 0 ) {
+                        h1 = p_c1; h2 = c1; h3 = p_c2; h4 = c2;
+                        goto exchange2opt;
+                    }
+                }
+                else
+                    break;
+            }
+            /* Or-opt moves of the segments c1 .. seg_last */
+            seg_pred = p_c1;
+            seg_succ = c1;
+            for ( len = 1 ; len <= OR_OPT_SEGMENT && len < n - 2 ; len++ ) {
+                seg_last = seg_succ;
+                seg_succ = SUCC(seg_last);
+                removal = instance_distance(seg_pred, c1) + instance_distance(seg_last, seg_succ)
+                    - instance_distance(seg_pred, seg_succ);
+                for ( h = 0 ; h < nn_count[c1] ; h++ ) {
+                    c2 = nn_list[c1][h];
+                    if ( removal <= instance_distance(c1, c2) )
+                        break;
+                    pos_c2 = POS(c2);
+                    if ( (pos_c2 - pos_c1 + n) % n < len )
+                        continue;  /* c2 is in the segment */
+                    /* c2, c1 .. seg_last, successor of c2 */
+                    if ( c2 != seg_pred ) {
+                        s_c2 = SUCC(c2);
+                        gain = instance_distance(c2, c1) + instance_distance(seg_last, s_c2)
+                            - instance_distance(c2, s_c2) - removal;
+                        if ( gain < 0 ) {
+                            or_x = c2; or_len = len; or_reversed = FALSE;
+                            h1 = seg_pred; h2 = seg_succ; h3 = c2; h4 = s_c2;
+                            goto exchange_or_opt;
+                        }
+                    }
+                    /* predecessor of c2, seg_last .. c1, c2 */
+                    if ( c2 != seg_succ ) {
+                        p_c2 = PRED(c2);
+                        gain = instance_distance(p_c2, seg_last) + instance_distance(c1, c2)
+                            - instance_distance(p_c2, c2) - removal;
+                        if ( gain < 0 ) {
+                            or_x = p_c2; or_len = len; or_reversed = TRUE;
+                            h1 = seg_pred; h2 = seg_succ; h3 = p_c2; h4 = c2;
+                            goto exchange_or_opt;
+                        }
+                    }
+                }
+            }
+            /* No exchange */
+            dlb[c1] = TRUE;
+            continue;
+
+            exchange2opt:
+            improvement_flag = TRUE;
+            dlb[h1] = FALSE; dlb[h2] = FALSE;
+            dlb[h3] = FALSE; dlb[h4] = FALSE;
+            two_opt_move( tour, pos, L, n, h1, h2, h3, h4 );
+            continue;
+
+            exchange_or_opt:
+            improvement_flag = TRUE;
+            dlb[h1] = FALSE; dlb[h2] = FALSE;
+            dlb[h3] = FALSE; dlb[h4] = FALSE;
+            dlb[c1] = FALSE; dlb[seg_last] = FALSE;
+            move_segment( tour, pos, L, n, c1, seg_last, or_len, or_x, or_reversed );
+        }
+    }
+
+    if ( L )
+        two_level_to_tour( L, tour );
+    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n, w->h_tour);
+    tour[n] = tour[0];
 }
 
-void three_opt_first( long int *tour, long int t_size )
+static void three_opt_move_two_level( struct two_level_list *L, long int n, long int move_flag,
+                                      long int h1, long int h2, long int h3, 
+                                      long int h4, long int h5, long int h6 )
+/*    
+      FUNCTION:       perform a 3-opt move of three_opt_first on a tour held in a two-level list
+      INPUT:          two-level list, number n of cities, type of the move (see move_flag in 
+                      three_opt_first) and the cities involved in it
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the tour is changed as by the array exchange of three_opt_first: the 
+                      longest of the three tour parts stays in place, the other two are 
+                      rewritten in place, possibly swapped and reversed
+ */
+{
+    long int pos_c1, pos_c2, pos_c3, n1, n2, n3, g, h, help;
+    long int val[3];
+
+    pos_c1 = two_level_pos( L, h1 ); pos_c2 = two_level_pos( L, h3 ); pos_c3 = two_level_pos( L, h5 );
+    if ( move_flag == 1 ) {
+        n1 = pos_c3 < pos_c2 ? pos_c2 - pos_c3 : n - (pos_c3 - pos_c2);
+        n2 = pos_c3 > pos_c1 ? pos_c3 - pos_c1 + 1 : n - (pos_c1 - pos_c3 + 1);
+        n3 = pos_c2 > pos_c1 ? n - (pos_c2 - pos_c1 + 1) : pos_c1 - pos_c2 + 1;
+    }
+    else if ( move_flag == 4 ) {
+        n1 = pos_c2 > pos_c1 ? pos_c2 - pos_c1 : n - (pos_c1 - pos_c2);
+        n2 = pos_c3 > pos_c2 ? pos_c3 - pos_c2 : n - (pos_c2 - pos_c3);
+        n3 = pos_c1 > pos_c3 ? pos_c1 - pos_c3 : n - (pos_c3 - pos_c1);
+    }
+    else {
+        n1 = pos_c3 < pos_c1 ? pos_c1 - pos_c3 : n - (pos_c3 - pos_c1);
+        n2 = pos_c3 > pos_c2 ? pos_c3 - pos_c2 : n - (pos_c2 - pos_c3);
+        n3 = pos_c2 > pos_c1 ? pos_c2 - pos_c1 : n - (pos_c1 - pos_c2);
+    }
+    val[0] = n1; val[1] = n2; val[2] = n3;
+    h = 0;
+    help = LONG_MIN;
+    for ( g = 0; g <= 2; g++) {
+        if ( help < val[g] ) {
+            help = val[g];
+            h = g;
+        }
+    }
+
+    /* the parts are h2 .. h3 (h2 .. h5 for move_flag 1), h4 .. h5 (h6 .. h3) and 
+       h6 .. h1 (h4 .. h1); the two parts that follow each other after the longest 
+       one are rewritten, starting at the position of the first of them */
+    switch ( move_flag ) {
+    case 1:
+        if ( h == 0 )
+            two_level_rearrange( L, h4, h1, h5, FALSE, TRUE, TRUE );
+        else if ( h == 1 )
+            two_level_rearrange( L, h6, h3, h1, TRUE, TRUE, FALSE );
+        else
+            two_level_rearrange( L, h2, h5, h3, TRUE, FALSE, TRUE );
+        break;
+    case 2:
+        if ( h == 0 )
+            two_level_rearrange( L, h2, h3, h5, FALSE, TRUE, TRUE );
+        else if ( h == 1 )
+            two_level_rearrange( L, h6, h1, h3, TRUE, TRUE, FALSE );
+        else
+            two_level_rearrange( L, h4, h5, h1, TRUE, FALSE, TRUE );
+        break;
+    case 3:
+        if ( h == 0 )
+            two_level_rearrange( L, h2, h3, h5, TRUE, TRUE, FALSE );
+        else if ( h == 1 )
+            two_level_rearrange( L, h6, h1, h3, TRUE, FALSE, TRUE );
+        else
+            two_level_rearrange( L, h4, h5, h1, FALSE, TRUE, TRUE );
+        break;
+    case 4:
+        if ( h == 0 )
+            two_level_rearrange( L, h4, h5, h1, TRUE, FALSE, FALSE );
+        else if ( h == 1 )
+            two_level_rearrange( L, h6, h1, h3, TRUE, FALSE, FALSE );
+        else
+            two_level_rearrange( L, h2, h3, h5, TRUE, FALSE, FALSE );
+        break;
+    }
+}
+
+void three_opt_first( int *tour, long int t_size )
 
 /*    
       FUNCTION:       3-opt the tour
@@ -662,15 +1123,9 @@ void three_opt_first( long int *tour, long int t_size )
 
     long int n = (long int) (t_size - 1);
    
-    long int i, j, g, h, l, nn, local_nn_ls;
+    long int i, j, g, h, l;
     
-    long int  **distance = compute_local_distances(tour, n);
-
-    long int  **nn_list = compute_local_nn_lists(distance, n);
-
-    long int *original_tour = (long int *) malloc(n * sizeof(long int));
-
-    for ( i = 0 ; i < n ; i++ ) { original_tour[i] = tour[i]; tour[i] = i; }
+    struct ls_workspace *w = ls_ws;
 
     long int   c1, c2, c3;           /* cities considered for an exchange */
     long int   s_c1, s_c2, s_c3;     /* successors of these cities        */
@@ -692,23 +1147,25 @@ void three_opt_first( long int *tour, long int t_size )
     long int decrease_breaks;    /* Stores decrease by breaking two edges (a,b) (c,d) */
     long int val[3];
     long int n1, n2, n3;
-    long int *pos;               /* positions of cities in tour */
-    long int *dlb;               /* vector containing don't look bits */
-    long int *h_tour;            /* help vector for performing exchange move */
-    long int *hh_tour;           /* help vector for performing exchange move */
-    long int *random_vector;
-
-    pos = (long int *) malloc(n * sizeof(long int));
-    dlb = (long int *) malloc(n * sizeof(long int));
-    h_tour = (long int *) malloc(n * sizeof(long int));
-    hh_tour = (long int *) malloc(n * sizeof(long int));
+    int      *pos;               /* positions of cities in tour */
+    int      *dlb;               /* vector containing don't look bits */
+    int      **nn_list;          /* candidate lists of the cities in the tour */
+    int      *nn_count;          /* lengths of the candidate lists */
+    int      *h_tour;            /* help vector for performing exchange move */
+    int      *hh_tour;           /* help vector for performing exchange move */
+    int      *random_vector;
+    struct two_level_list *L;    /* two-level list of a long tour, else NULL */
+
+    L = prepare_ls_workspace( w, tour, n );
+    pos = w->pos;
+    dlb = w->dlb;
+    nn_list = w->nn_list;
+    nn_count = w->nn_count;
+    h_tour = w->h_tour;
+    hh_tour = w->hh_tour;
+    random_vector = w->random_vector;
 
-    for ( i = 0 ; i < n ; i++ ) {
-        pos[tour[i]] = i;
-        dlb[i] = FALSE;
-    }
     improvement_flag = TRUE;
-    random_vector = generate_random_permutation( n );
 
     while ( improvement_flag ) {
         move_value = 0;
@@ -722,35 +1179,29 @@ void three_opt_first( long int *tour, long int t_size )
             opt2_flag = FALSE;
 
             move_flag = 0;
-            pos_c1 = pos[c1];
-            s_c1 = tour[pos_c1+1];
-            if (pos_c1 > 0)
-                p_c1 = tour[pos_c1-1];
-            else
-                p_c1 = tour[n-1];
+            pos_c1 = POS(c1);
+            s_c1 = SUCC(c1);
+            p_c1 = PRED(c1);
 
             h = 0;    /* Search for one of the h-nearest neighbours */
-            while ( h < local_nn_ls ) {
+            while ( h < nn_count[c1] ) {
 
                 c2   = nn_list[c1][h];  /* second city, determine its position */
-                pos_c2 = pos[c2];
-                s_c2 = tour[pos_c2+1];
-                if (pos_c2 > 0)
-                    p_c2 = tour[pos_c2-1];
-                else
-                    p_c2 = tour[n-1];
+                pos_c2 = POS(c2);
+                s_c2 = SUCC(c2);
+                p_c2 = PRED(c2);
 
                 diffs = 0; diffp = 0;
 
-                radius = distance[c1][s_c1];
-                add1   = distance[c1][c2];
+                radius = instance_distance(c1, s_c1);
+                add1   = instance_distance(c1, c2);
 
                 /* Here a fixed radius neighbour search is performed */
                 if ( radius > add1 ) {
-                    decrease_breaks = - radius - distance[c2][s_c2];
-                    diffs =  decrease_breaks + add1 + distance[s_c1][s_c2];
-                    diffp =  - radius - distance[c2][p_c2] +
-                            distance[c1][p_c2] + distance[s_c1][c2];
+                    decrease_breaks = - radius - instance_distance(c2, s_c2);
+                    diffs =  decrease_breaks + add1 + instance_distance(s_c1, s_c2);
+                    diffp =  - radius - instance_distance(c2, p_c2) +
+                            instance_distance(c1, p_c2) + instance_distance(s_c1, c2);
                 }
                 else
                     break;
@@ -772,22 +1223,19 @@ void three_opt_first( long int *tour, long int t_size )
                 }
                 /* Now perform the innermost search */
                 g = 0;
-                while (g < local_nn_ls) {
+                while (g < nn_count[s_c1]) {
 
                     c3   = nn_list[s_c1][g];
-                    pos_c3 = pos[c3];
-                    s_c3 = tour[pos_c3+1];
-                    if (pos_c3 > 0)
-                        p_c3 = tour[pos_c3-1];
-                    else
-                        p_c3 = tour[n-1];
+                    pos_c3 = POS(c3);
+                    s_c3 = SUCC(c3);
+                    p_c3 = PRED(c3);
 
                     if ( c3 == c1 ) {
                         g++;
                         continue;
                     }
                     else {
-                        add2 = distance[s_c1][c3];
+                        add2 = instance_distance(s_c1, c3);
                         /* Perform fixed radius neighbour search for innermost search */
                         if ( decrease_breaks + add1 < add2 ) {
 
@@ -810,9 +1258,9 @@ void three_opt_first( long int *tour, long int t_size )
                                 /* We have to add edges (c1,c2), (c3,s_c1), (p_c3,s_c2) to get
                                    valid tour; it's the only possibility */
 
-                                gain = decrease_breaks - distance[c3][p_c3] +
+                                gain = decrease_breaks - instance_distance(c3, p_c3) +
                                         add1 + add2 +
-                                        distance[p_c3][s_c2];
+                                        instance_distance(p_c3, s_c2);
 
                                 /* check for improvement by move */
                                 if ( gain < move_value ) {
@@ -829,9 +1277,9 @@ void three_opt_first( long int *tour, long int t_size )
 
                                 /* We have to add edges (c1,c2), (s_c1,c3), (s_c2,s_c3) */
 
-                                gain = decrease_breaks - distance[c3][s_c3] +
+                                gain = decrease_breaks - instance_distance(c3, s_c3) +
                                         add1 + add2 +
-                                        distance[s_c2][s_c3];
+                                        instance_distance(s_c2, s_c3);
 
                                 if ( pos_c2 == pos_c3 ) {
                                     gain = 20000;
@@ -849,10 +1297,10 @@ void three_opt_first( long int *tour, long int t_size )
                                 }
 
                                 /* or add edges (c1,c2), (s_c1,c3), (p_c2,p_c3) */
-                                gain = - radius - distance[p_c2][c2]
-                                                                          - distance[p_c3][c3] +
+                                gain = - radius - instance_distance(p_c2, c2)
+                                                                          - instance_distance(p_c3, c3) +
                                                                           add1 + add2 +
-                                                                          distance[p_c2][p_c3];
+                                                                          instance_distance(p_c2, p_c3);
 
                                 if ( c3 == c2 || c2 == c1 || c1 == c3 || p_c2 == c1 ) {
                                     gain = 2000000;
@@ -871,9 +1319,9 @@ void three_opt_first( long int *tour, long int t_size )
                                    i.e. delete edges (c1,s_c1), (c2,p_c2), (c3,s_c3) and 
                                    add edges (c1,c2), (c3,s_c1), (p_c2,s_c3) */
 
-                                   gain = - radius - distance[p_c2][c2] -
-                                   distance[c3][s_c3]
-                                                         + add1 + add2 + distance[p_c2][s_c3];
+                                   gain = - radius - instance_distance(p_c2, c2) -
+                                   instance_distance(c3, s_c3)
+                                                         + add1 + add2 + instance_distance(p_c2, s_c3);
 
                                    /* check for improvement */
                                    if ( gain < move_value ) {
@@ -889,7 +1337,7 @@ void three_opt_first( long int *tour, long int t_size )
                             }
                         }
                         else
-                            g = local_nn_ls + 1;
+                            g = nn_count[s_c1];
                     }
                     g++;
                 }
@@ -903,9 +1351,12 @@ void three_opt_first( long int *tour, long int t_size )
                 if ( move_flag ) {
                     dlb[h1] = FALSE; dlb[h2] = FALSE; dlb[h3] = FALSE;
                     dlb[h4] = FALSE; dlb[h5] = FALSE; dlb[h6] = FALSE;
-                    pos_c1 = pos[h1]; pos_c2 = pos[h3]; pos_c3 = pos[h5];
+                    pos_c1 = POS(h1); pos_c2 = POS(h3); pos_c3 = POS(h5);
 
-                    if ( move_flag == 4 ) {
+                    if ( L ) {
+                        three_opt_move_two_level( L, n, move_flag, h1, h2, h3, h4, h5, h6 );
+                    }
+                    else if ( move_flag == 4 ) {
 
                         if ( pos_c2 > pos_c1 )
                             n1 = pos_c2 - pos_c1;
@@ -1632,65 +2083,467 @@ void three_opt_first( long int *tour, long int t_size )
                     /* Now perform move */
                     dlb[h1] = FALSE; dlb[h2] = FALSE;
                     dlb[h3] = FALSE; dlb[h4] = FALSE;
-                    if ( pos[h3] < pos[h1] ) {
-                        help = h1; h1 = h3; h3 = help;
-                        help = h2; h2 = h4; h4 = help;
+                    two_opt_move( tour, pos, L, n, h1, h2, h3, h4 );
+                }
+            }
+            else {
+                dlb[c1] = TRUE;
+            }
+        }
+    }
+
+    if ( L )
+        two_level_to_tour( L, tour );
+    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n, w->h_tour);
+    tour[n] = tour[0];
+    
+}
+
+static void build_route( struct ls_workspace *w, const int *tour, long int last )
+/*    
+      FUNCTION:       compute the route of the packing-aware local search
+      INPUT:          workspace, tour and position last of city instance.n-2 in it
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the positions of the cities of the tour, the route and the load, 
+                      arrival time and prefix sums at each city of the route are set
+      COMMENTS:       as in try_to_pack (thop.c), the thief only visits the depot, the 
+                      cities in which items are picked up and the final city, and arrival 
+                      times are accumulated in the same way
+ */
+{
+    long int i, c, d, r, carried;
+    double   speed;
+
+    r = 0;
+    carried = 0;
+    for ( i = 0 ; i <= last ; i++ ) {
+        c = tour[i];
+        w->pos[c] = i;
+        if ( i > 0 && i < last && w->city_weight[c] == 0 )
+            continue;
+        if ( r == 0 ) {
+            w->arrival[0] = w->slope[0] = w->moment[0] = 0.;
+        }
+        else {
+            d = instance_distance( w->route[r-1], c );
+            speed = instance.max_speed - w->nu * carried;
+            w->arrival[r] = w->arrival[r-1] + d / speed;
+            w->slope[r] = w->slope[r-1] + d * w->nu / ( speed * speed );
+            w->moment[r] = w->moment[r-1] + d * carried * w->nu / ( speed * speed );
+        }
+        carried += w->city_weight[c];
+        w->route[r] = c;
+        w->route_index[c] = r;
+        w->load[r] = carried;
+        r++;
+    }
+    w->route_size = r;
+}
+
+static void update_route( struct ls_workspace *w, long int from )
+/*    
+      FUNCTION:       update the route after more items are picked up in one of its cities 
+                      or a part of it is reversed
+      INPUT:          workspace and index r of a city of the route such that the route 
+                      up to the arrival at route[r] did not change
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the loads from route[r] on and the arrival times and prefix sums 
+                      after it are recomputed
+ */
+{
+    long int r, d, carried;
+    double   speed;
+
+    carried = from > 0 ? w->load[from-1] : 0;
+    for ( r = from ; r < w->route_size ; r++ ) {
+        carried += w->city_weight[w->route[r]];
+        w->load[r] = carried;
+        if ( r + 1 < w->route_size ) {
+            d = instance_distance( w->route[r], w->route[r+1] );
+            speed = instance.max_speed - w->nu * carried;
+            w->arrival[r+1] = w->arrival[r] + d / speed;
+            w->slope[r+1] = w->slope[r] + d * w->nu / ( speed * speed );
+            w->moment[r+1] = w->moment[r] + d * carried * w->nu / ( speed * speed );
+        }
+    }
+}
+
+static double shift_time( const struct ls_workspace *w, long int from, long int to, long int delta )
+/*    
+      FUNCTION:       change of the travel time from city route[from] to city route[to] 
+                      if delta more is carried along this part of the route
+      INPUT:          workspace, indices from <= to in the route and change of the weight
+      OUTPUT:         change of the travel time
+ */
+{
+    long int k;
+    double   t = 0.;
+
+    for ( k = from ; k < to ; k++ )
+        t += instance_distance( w->route[k], w->route[k+1] ) / 
+            ( instance.max_speed - w->nu * ( w->load[k] + delta ) );
+    return t - ( w->arrival[to] - w->arrival[from] );
+}
+
+static double reversal_time( const struct ls_workspace *w, long int u, long int v, long int exact )
+/*    
+      FUNCTION:       change of the travel time if the part route[u] .. route[v] of the 
+                      route is traversed in reverse order
+      INPUT:          workspace, indices 0 < u < v < route_size - 1, and whether the exact 
+                      change or a lower bound is computed
+      OUTPUT:         change of the travel time or a lower bound of it
+      COMMENTS:       an arc inside the reversed part that is left with load W is then left 
+                      with load[u-1] + load[v] - W. The travel time of an arc is convex in 
+                      the load, so its tangent gives a lower bound, whose sum over the part 
+                      is taken from the prefix sums in constant time
+ */
+{
+    long int a = w->route[u-1], b = w->route[u], c = w->route[v], e = w->route[v+1];
+    long int k, turned = w->load[u-1] + w->load[v];
+    double   t;
+
+    t = ( instance_distance( a, c ) - instance_distance( a, b ) ) / 
+        ( instance.max_speed - w->nu * w->load[u-1] ) +
+        ( instance_distance( b, e ) - instance_distance( c, e ) ) / 
+        ( instance.max_speed - w->nu * w->load[v] );
+    if ( !exact )
+        return t + turned * ( w->slope[v] - w->slope[u] ) - 2. * ( w->moment[v] - w->moment[u] );
+    for ( k = u ; k < v ; k++ )
+        t += instance_distance( w->route[k], w->route[k+1] ) / 
+            ( instance.max_speed - w->nu * ( turned - w->load[k] ) );
+    return t - ( w->arrival[v] - w->arrival[u] );
+}
+
+static long int sort_city_items( const struct ls_workspace *w, long int c, long int room )
+/*    
+      FUNCTION:       put the items of a city into w->items by decreasing profit per weight
+      INPUT:          workspace, city c and remaining capacity of the knapsack
+      OUTPUT:         number q of the best items of c that fit together into the knapsack
+ */
+{
+    long int i, k, j, q, weight;
+    int      *items = w->items;
+
+    for ( k = instance.city_item_start[c], i = 0 ; k < instance.city_item_start[c+1] ; k++, i++ ) {
+        j = instance.city_items[k];
+        for ( q = i ; q > 0 && instance.itemptr[j].profit * instance.itemptr[items[q-1]].weight >
+                                instance.itemptr[items[q-1]].profit * instance.itemptr[j].weight ; q-- )
+            items[q] = items[q-1];
+        items[q] = j;
+    }
+    for ( q = 0, weight = 0 ; q < i && weight + instance.itemptr[items[q]].weight <= room ; q++ )
+        weight += instance.itemptr[items[q]].weight;
+    return q;
+}
+
+static long int insert_after( struct ls_workspace *w, int *tour, long int n, long int c, long int a )
+/*    
+      FUNCTION:       move or insert a city of the packing-aware local search after another one
+      INPUT:          workspace, tour, its size n (including the closing city), city c, 
+                      and city a of the tour
+      OUTPUT:         new size of the tour
+      (SIDE)EFFECTS:  c is removed from its place, if it is in the tour, and inserted 
+                      after a; the positions are not updated
+ */
+{
+    long int i, target = w->pos[a] + 1;
+
+    if ( w->on_tour[c] == w->stamp ) {
+        for ( i = w->pos[c] ; i < n - 1 ; i++ )
+            tour[i] = tour[i+1];
+        n--;
+        if ( w->pos[c] < target )
+            target--;
+    }
+    for ( i = n ; i > target ; i-- )
+        tour[i] = tour[i-1];
+    tour[target] = c;
+    w->on_tour[c] = w->stamp;
+    return n + 1;
+}
+
+long int packing_opt_first( int *tour, long int *t_size, char *p )
+/*    
+      FUNCTION:       improve a tour together with its packing plan, measuring the travel 
+                      time with the weight actually carried
+      INPUT:          pointer to the tour, pointer to its size (including the closing city) 
+                      and a feasible packing plan for it
+      OUTPUT:         fitness of the new solution, as computed by compute_fitness
+      (SIDE)EFFECTS:  tour, its size and the packing plan are changed; no item is dropped 
+                      unless a city with more profit takes the place of its city
+      COMMENTS:       the moves work on the route of compute_fitness, i.e. the cities in which 
+                      items are picked up: picking up one more item in a city of the route, 
+                      reversing a part of the route (2-opt), moving a city of the route next 
+                      to a candidate on the route, inserting a city with its best items that 
+                      fit next to a candidate on the route, and replacing a city of the route 
+                      and its items by a candidate with more profit. Cities not 
+                      in the tour are inserted into it and replaced cities leave it. With 
+                      the prefix sums of the route, each move gets a lower bound of its 
+                      change of travel time in constant time; only moves that pass it are 
+                      evaluated exactly along the part of the route whose load changes. A 
+                      move is applied if it adds profit and keeps the travel time within 
+                      instance.max_time, or if it shortens the travel time
+ */
+{
+    long int n = *t_size, last = n - 3;
+    long int i, h, k, j, l, m, s, q, R, c1, c2, a, target, n_route;
+    long int improvement_flag, profit, weight, w_q, p_q, w_c1, p_c1, nn;
+    double   limit, tol, slack, local, speed;
+    struct ls_workspace *w = ls_ws;
+    int      *pos = w->pos;
+    int      *dlb = w->dlb;
+    int      *random_vector = w->random_vector;
+    int      *items = w->items;
+
+    w->nu = ( instance.max_speed - instance.min_speed ) / instance.capacity_of_knapsack;
+    tol = 1e-9 * instance.max_time;
+    limit = instance.max_time - tol;
+    nn = MIN( nn_ls, instance.n_near );
+
+    if ( w->stamp == UINT_MAX ) {
+        for ( i = 0 ; i < instance.n ; i++ )
+            w->on_tour[i] = 0;
+        w->stamp = 0;
+    }
+    w->stamp++;
+    profit = weight = 0;
+    for ( i = 0 ; i < n - 1 ; i++ ) {
+        c1 = tour[i];
+        w->on_tour[c1] = w->stamp;
+        w->city_weight[c1] = 0;
+        dlb[c1] = FALSE;
+        for ( k = instance.city_item_start[c1] ; k < instance.city_item_start[c1+1] ; k++ ) {
+            j = instance.city_items[k];
+            if ( p[j] ) {
+                w->city_weight[c1] += instance.itemptr[j].weight;
+                profit += instance.itemptr[j].profit;
+            }
+        }
+        weight += w->city_weight[c1];
+    }
+    build_route( w, tour, last );
+
+/* cities that may be added to the route */
+#define OUTSIDE( c )  ( ( c ) != 0 && ( c ) < instance.n - 2 && \
+                        instance.city_item_start[c] < instance.city_item_start[( c ) + 1] && \
+                        ( w->on_tour[c] != w->stamp || w->city_weight[c] == 0 ) )
+#define ON_ROUTE( c ) ( w->on_tour[c] == w->stamp && ( ( c ) == 0 || ( c ) == instance.n - 2 || \
+                                                      w->city_weight[c] > 0 ) )
+
+    improvement_flag = TRUE;
+
+    while ( improvement_flag ) {
+
+        improvement_flag = FALSE;
+
+        /* the cities of the route in random order */
+        n_route = w->route_size;
+        for ( i = 0 ; i < n_route ; i++ )
+            random_vector[i] = w->route[i];
+        for ( i = 0 ; i < n_route ; i++ ) {
+            k = i + (long int) ( rng_ran01( &rng ) * ( n_route - i ) );
+            h = random_vector[i];
+            random_vector[i] = random_vector[k];
+            random_vector[k] = h;
+        }
+
+        for ( l = 0 ; l < n_route ; l++ ) {
+
+            c1 = random_vector[l];
+            if ( !ON_ROUTE(c1) || ( dlb_flag && dlb[c1] ) )
+                continue;
+            R = w->route_size - 1;
+            m = w->route_index[c1];
+            slack = limit - w->arrival[R];
+            c2 = c1;
+
+            /* pick up one more item in c1 */
+            if ( m > 0 ) {
+                for ( k = instance.city_item_start[c1] ; k < instance.city_item_start[c1+1] ; k++ ) {
+                    j = instance.city_items[k];
+                    w_q = instance.itemptr[j].weight;
+                    if ( p[j] || weight + w_q > instance.capacity_of_knapsack )
+                        continue;
+                    if ( w_q * ( w->slope[R] - w->slope[m] ) > slack || 
+                         shift_time( w, m, R, w_q ) > slack )
+                        continue;
+                    p[j] = 1;
+                    w->city_weight[c1] += w_q;
+                    weight += w_q;
+                    profit += instance.itemptr[j].profit;
+                    update_route( w, m );
+                    improvement_flag = TRUE;
+                    goto reset_dlb;
+                }
+            }
+
+            /* 2-opt moves that make c1 a neighbour of another city c2 of the route */
+            for ( h = 0 ; h < nn ; h++ ) {
+                c2 = instance.nn_list[c1][h];
+                if ( !ON_ROUTE(c2) )
+                    continue;
+                i = MIN( m, w->route_index[c2] );
+                k = MAX( m, w->route_index[c2] );
+                /* reverse route[i+1] .. route[k] or route[i] .. route[k-1] */
+                for ( s = 0 ; s < 2 ; s++ ) {
+                    if ( s == 0 ? k + 1 > R || i + 1 >= k : i < 1 || i >= k - 1 )
+                        continue;
+                    if ( reversal_time( w, i + 1 - s, k - s, FALSE ) >= -tol ||
+                         reversal_time( w, i + 1 - s, k - s, TRUE ) >= -tol )
+                        continue;
+                    for ( a = pos[w->route[i+1-s]], target = pos[w->route[k-s]] ; a < target ; a++, target-- ) {
+                        j = tour[a];
+                        tour[a] = tour[target];
+                        tour[target] = j;
+                        pos[tour[a]] = a;
+                        pos[tour[target]] = target;
                     }
-                    if ( pos[h3]-pos[h2] < n / 2 + 1) {
-                        /* reverse inner part from pos[h2] to pos[h3] */
-                        i = pos[h2]; j = pos[h3];
-                        while (i < j) {
-                            c1 = tour[i];
-                            c2 = tour[j];
-                            tour[i] = c2;
-                            tour[j] = c1;
-                            pos[c1] = j;
-                            pos[c2] = i;
-                            i++; j--;
+                    for ( a = i + 1 - s, target = k - s ; a < target ; a++, target-- ) {
+                        j = w->route[a];
+                        w->route[a] = w->route[target];
+                        w->route[target] = j;
+                        w->route_index[w->route[a]] = a;
+                        w->route_index[w->route[target]] = target;
+                    }
+                    update_route( w, i - s );
+                    improvement_flag = TRUE;
+                    goto reset_dlb;
+                }
+            }
+
+            /* move c1 next to another city c2 of the route */
+            if ( m > 0 && m < R ) {
+                w_c1 = w->city_weight[c1];
+                speed = instance.max_speed - w->nu * w->load[m-1];
+                for ( h = 0 ; h < nn ; h++ ) {
+                    c2 = instance.nn_list[c1][h];
+                    if ( !ON_ROUTE(c2) )
+                        continue;
+                    /* between route[s] and route[s+1] */
+                    for ( s = w->route_index[c2] - 1 ; s <= w->route_index[c2] ; s++ ) {
+                        if ( s < 0 || s >= R || s == m - 1 || s == m )
+                            continue;
+                        a = s > m ? -w_c1 : w_c1;  /* change of the load between the two places */
+                        local = instance_distance( w->route[m-1], w->route[m+1] ) / 
+                            ( speed - ( s > m ? 0. : w->nu * w_c1 ) ) - ( w->arrival[m+1] - w->arrival[m-1] ) +
+                            instance_distance( w->route[s], c1 ) / 
+                            ( instance.max_speed - w->nu * ( w->load[s] + ( s > m ? a : 0 ) ) ) +
+                            instance_distance( c1, w->route[s+1] ) / 
+                            ( instance.max_speed - w->nu * ( w->load[s] + ( s > m ? 0 : a ) ) ) - 
+                            ( w->arrival[s+1] - w->arrival[s] );
+                        i = s > m ? m + 1 : s + 1;
+                        k = s > m ? s : m - 1;
+                        if ( local + a * ( w->slope[k] - w->slope[i] ) >= -tol || 
+                             local + shift_time( w, i, k, a ) >= -tol )
+                            continue;
+                        n = insert_after( w, tour, n, c1, w->route[s] );
+                        goto improvement;
+                    }
+                }
+            }
+
+            /* insert a candidate c2 with its best items before or after c1 */
+            for ( h = 0 ; h < nn ; h++ ) {
+                c2 = instance.nn_list[c1][h];
+                if ( !OUTSIDE(c2) )
+                    continue;
+                q = 0;
+                for ( s = m - 1 ; s <= m ; s++ ) {
+                    if ( s < 0 || s >= R )
+                        continue;
+                    if ( q == 0 && ( q = sort_city_items( w, c2, instance.capacity_of_knapsack - weight ) ) == 0 )
+                        break;
+                    speed = instance.max_speed - w->nu * w->load[s];
+                    for ( w_q = 0, k = 0 ; k < q ; k++ )
+                        w_q += instance.itemptr[items[k]].weight;
+                    for ( k = q ; k > 0 ; w_q -= instance.itemptr[items[--k]].weight ) {
+                        local = ( instance_distance( w->route[s], c2 ) - instance_distance( w->route[s], w->route[s+1] ) ) / speed +
+                            instance_distance( c2, w->route[s+1] ) / ( speed - w->nu * w_q );
+                        if ( local + w_q * ( w->slope[R] - w->slope[s+1] ) > slack || 
+                             local + shift_time( w, s + 1, R, w_q ) > slack )
+                            continue;
+                        n = insert_after( w, tour, n, c2, w->route[s] );
+                        last = n - 3;
+                        w->city_weight[c2] = w_q;
+                        weight += w_q;
+                        for ( i = 0 ; i < k ; i++ ) {
+                            p[items[i]] = 1;
+                            profit += instance.itemptr[items[i]].profit;
                         }
+                        goto improvement;
                     }
-                    else {
-                        /* reverse outer part from pos[h4] to pos[h1] */
-                        i = pos[h1]; j = pos[h4];
-                        if ( j > i )
-                            help = n - (j - i) + 1;
+                }
+            }
+
+            /* replace c1 and its items by a candidate c2 with more profit */
+            if ( m == 0 || m == R )
+                goto no_improvement;
+            w_c1 = w->city_weight[c1];
+            p_c1 = 0;
+            for ( k = instance.city_item_start[c1] ; k < instance.city_item_start[c1+1] ; k++ )
+                if ( p[instance.city_items[k]] )
+                    p_c1 += instance.itemptr[instance.city_items[k]].profit;
+            speed = instance.max_speed - w->nu * w->load[m-1];
+            for ( h = 0 ; h < nn ; h++ ) {
+                c2 = instance.nn_list[c1][h];
+                if ( !OUTSIDE(c2) )
+                    continue;
+                q = sort_city_items( w, c2, instance.capacity_of_knapsack - weight + w_c1 );
+                for ( w_q = 0, p_q = 0, k = 0 ; k < q ; k++ ) {
+                    w_q += instance.itemptr[items[k]].weight;
+                    p_q += instance.itemptr[items[k]].profit;
+                }
+                for ( k = q ; k > 0 && p_q > p_c1 ; k-- ) {
+                    local = instance_distance( w->route[m-1], c2 ) / speed +
+                        instance_distance( c2, w->route[m+1] ) / ( speed - w->nu * w_q ) -
+                        ( w->arrival[m+1] - w->arrival[m-1] );
+                    if ( local + ( w_q - w_c1 ) * ( w->slope[R] - w->slope[m+1] ) <= slack &&
+                         local + shift_time( w, m + 1, R, w_q - w_c1 ) <= slack ) {
+                        for ( j = instance.city_item_start[c1] ; j < instance.city_item_start[c1+1] ; j++ )
+                            p[instance.city_items[j]] = 0;
+                        if ( w->on_tour[c2] == w->stamp )
+                            tour[pos[c2]] = c1;
                         else
-                            help = (i - j) + 1;
-                        help = help / 2;
-                        for ( h = 0 ; h < help ; h++ ) {
-                            c1 = tour[i];
-                            c2 = tour[j];
-                            tour[i] = c2;
-                            tour[j] = c1;
-                            pos[c1] = j;
-                            pos[c2] = i;
-                            i--; j++;
-                            if ( i < 0 )
-                                i = n - 1;
-                            if ( j >= n )
-                                j = 0;
-                        }
-                        tour[n] = tour[0];
+                            w->on_tour[c1] = 0;
+                        tour[pos[c1]] = c2;
+                        w->on_tour[c2] = w->stamp;
+                        w->city_weight[c1] = 0;
+                        w->city_weight[c2] = w_q;
+                        weight += w_q - w_c1;
+                        profit += p_q - p_c1;
+                        for ( i = 0 ; i < k ; i++ )
+                            p[items[i]] = 1;
+                        goto improvement;
                     }
+                    w_q -= instance.itemptr[items[k-1]].weight;
+                    p_q -= instance.itemptr[items[k-1]].profit;
                 }
             }
-            else {
-                dlb[c1] = TRUE;
+
+            no_improvement:
+            dlb[c1] = TRUE;
+            continue;
+
+            improvement:
+            improvement_flag = TRUE;
+            build_route( w, tour, last );
+            reset_dlb:
+            for ( i = 0 ; i < 2 ; i++ ) {
+                c1 = i ? c2 : random_vector[l];
+                dlb[c1] = FALSE;
+                if ( ON_ROUTE(c1) ) {
+                    m = w->route_index[c1];
+                    if ( m > 0 )
+                        dlb[w->route[m-1]] = FALSE;
+                    if ( m < w->route_size - 1 )
+                        dlb[w->route[m+1]] = FALSE;
+                }
             }
         }
     }
+#undef OUTSIDE
+#undef ON_ROUTE
 
-    for ( i = 0 ; i < n ; i++ ) tour[i] = original_tour[tour[i]];
-    
-    if ( tour[0] != 0 || tour[1] == instance.n-1) rotate_tour(tour, n);
-    tour[n] = tour[0];
-    
-    free( random_vector );
-    free( h_tour );
-    free( hh_tour );
-    free( pos );
-    free( dlb );
-    free( distance );
-    free( nn_list );
-    free( original_tour);
+    *t_size = n;
+    return instance.UB + 1 - profit;
 }
@@ -50,14 +50,44 @@
 
  ***************************************************************************/
 
+#define OR_OPT_SEGMENT  3   /* maximal number of cities moved by an Or-opt move */
+
 extern long int ls_flag;
 
 extern long int nn_ls; 
 
 extern long int dlb_flag; 
 
-void two_opt_first( long int *tour, long int t_size );
+extern long int dlb_seed_flag;
+
+extern long int two_level_size;
+
+extern long int ls_ants;
+
+extern long int ls_diff;
+
+extern long int ls_budget_flag;
+
+struct ls_workspace;
+
+extern __thread struct ls_workspace *ls_ws;  /* workspace used by the local search, one per thread */
+
+void two_opt_first( int *tour, long int t_size );
+
+void two_h_opt_first( int *tour, long int t_size );
+
+void or_opt_first( int *tour, long int t_size );
+
+void three_opt_first( int *tour, long int t_size );
+
+long int packing_opt_first( int *tour, long int *t_size, char *p );
+
+void allocate_ls_reference( void );
+
+void set_ls_reference( const int *tour, long int t_size );
+
+void free_ls_reference( void );
 
-void two_h_opt_first( long int *tour, long int t_size );
+struct ls_workspace * allocate_ls_workspace( void );
 
-void three_opt_first( long int *tour, long int t_size );
+void free_ls_workspace( struct ls_workspace *w );
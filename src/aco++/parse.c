@@ -7,9 +7,12 @@
 
 
 #include "inout.h"
+#include "thop.h"
 #include "utilities.h"
 #include "ants.h"
 #include "ls.h"
+#include "threads.h"
+#include "timer.h"
 
 
 #ifndef STR_ERR_UNKNOWN_LONG_OPT
@@ -51,9 +54,42 @@
 #define STR_HELP_PACKING_TRIES \
         "  -p, --ptries          number of tries to construct a packing plan from a give tour\n"
 
+#define STR_HELP_PARTIALSORT \
+        "      --partialsort     1: sort the items of a packing try lazily   0: sort them all\n"
+
+#define STR_HELP_PACKINGCACHE \
+        "      --packingcache    number of entries of the cache of packing plans (0: no cache)\n"
+
 #define STR_HELP_TIME \
         "  -t, --time            maximum time for each trial\n"
 
+#define STR_HELP_THREADS \
+        "      --threads         number of threads used to construct the ants and apply local search\n"
+
+#define STR_HELP_STEPMAJOR \
+        "      --stepmajor       1: move all ants one step at a time   0: build one tour after the other\n"
+
+#define STR_HELP_INCREMENTAL \
+        "      --incremental     1: recompute the total information only on arcs that receive pheromone (not for BWAS, ACS)\n"
+
+#define STR_HELP_LAZY \
+        "      --lazy            1: evaporate the trails of an arc when it is read (no local search, not for ACS)\n"
+
+#define STR_HELP_SPARSE \
+        "      --sparse          1: store only the trails of candidate list and elite arcs   0: full matrices (default: 1 beyond 10000 cities)\n"
+
+#define STR_HELP_MATRIXFREE \
+        "      --matrixfree      1: compute distances on demand   0: distance matrix (default: 1 beyond 10000 cities)\n"
+
+#define STR_HELP_COMPACT \
+        "      --compact         1: store the distance matrix in 32 bits if the distances fit   0: 64 bits\n"
+
+#define STR_HELP_KDTREE \
+        "      --kdtree          1: build the candidate lists with a k-d tree   0: sort all distances (always for GEO)\n"
+
+#define STR_HELP_POWULPS \
+        "      --powulps         max. error in ulps of the fast tau^alpha (0: exact pow)\n"
+
 #define STR_HELP_SEED \
         "      --seed            seed for the random number generator\n"
 
@@ -88,11 +124,26 @@
         "  -k, --nnls            number of nearest neighbors for local search\n"
 
 #define STR_HELP_LOCALSEARCH \
-        "  -l, --localsearch     0: no local search   1: 2-opt   2: 2.5-opt   3: 3-opt\n"
+        "  -l, --localsearch     0: no local search   1: 2-opt   2: 2.5-opt   3: 3-opt   4: 2-opt and Or-opt   5: packing-aware\n"
 
 #define STR_HELP_DLB \
         "  -d, --dlb             1 use don't look bits in local search\n"
 
+#define STR_HELP_DLBSEED \
+        "      --dlbseed         1: search only from cities at arcs that are not in the restart-best tour\n"
+
+#define STR_HELP_TWOLEVEL \
+        "      --twolevel        min. number of cities of tours kept in a two-level list by 2-opt, Or-opt, 3-opt (0: never)\n"
+
+#define STR_HELP_LSANTS \
+        "      --lsants          local search only for this many best ants of an iteration (0: all, unless --lsdiff is given)\n"
+
+#define STR_HELP_LSDIFF \
+        "      --lsdiff          local search also for ants with more arcs than this not in the restart-best tour (-1: never)\n"
+
+#define STR_HELP_LSBUDGET \
+        "      --lsbudget        1: adapt the local search time per iteration to the improvement per ms (not reproducible)\n"
+
 #define STR_HELP_AS \
         "  -u, --as              apply basic Ant System\n"
 
@@ -111,6 +162,12 @@
 #define STR_HELP_ACS \
         "  -z, --acs             apply ant colony system\n"
 
+#define STR_HELP_PACO \
+        "      --paco            apply population-based ACO\n"
+
+#define STR_HELP_POPULATION \
+        "      --population      number of tours in the archive of population-based ACO\n"
+
 #define STR_HELP_LOG \
         "      --log             save an extra file (<outputfile>.log) with log messages\n"
 
@@ -123,6 +180,8 @@ static const char *const STR_HELP[] = {
         STR_HELP_TRIES ,
         STR_HELP_TOURS ,
         STR_HELP_PACKING_TRIES ,
+        STR_HELP_PARTIALSORT ,
+        STR_HELP_PACKINGCACHE ,
         STR_HELP_TIME ,
         STR_HELP_OPTIMUM ,
         STR_HELP_ANTS ,
@@ -136,13 +195,29 @@ static const char *const STR_HELP[] = {
         STR_HELP_NNLS ,
         STR_HELP_LOCALSEARCH ,
         STR_HELP_DLB ,
+        STR_HELP_DLBSEED ,
+        STR_HELP_TWOLEVEL ,
+        STR_HELP_LSANTS ,
+        STR_HELP_LSDIFF ,
+        STR_HELP_LSBUDGET ,
         STR_HELP_AS ,
         STR_HELP_EAS ,
         STR_HELP_RAS ,
         STR_HELP_MMAS ,
         STR_HELP_BWAS ,
         STR_HELP_ACS ,        
+        STR_HELP_PACO ,
+        STR_HELP_POPULATION ,
         STR_HELP_SEED ,        
+        STR_HELP_THREADS ,
+        STR_HELP_STEPMAJOR ,
+        STR_HELP_INCREMENTAL ,
+        STR_HELP_LAZY ,
+        STR_HELP_SPARSE ,
+        STR_HELP_MATRIXFREE ,
+        STR_HELP_COMPACT ,
+        STR_HELP_KDTREE ,
+        STR_HELP_POWULPS ,
         STR_HELP_LOG ,
         STR_HELP_HELP,
         NULL
@@ -165,12 +240,45 @@ struct options {
     /* Set to 1 if option --ptries (-p) has been specified.  */
     unsigned int opt_ptries : 1;
     
+    /* Set to 1 if option --partialsort has been specified.  */
+    unsigned int opt_partialsort : 1;
+    
+    /* Set to 1 if option --packingcache has been specified.  */
+    unsigned int opt_packingcache : 1;
+    
     /* Set to 1 if option --seed has been specified.  */
     unsigned int opt_seed : 1;
 
     /* Set to 1 if option --time (-t) has been specified.  */
     unsigned int opt_time : 1;
     
+    /* Set to 1 if option --threads has been specified.  */
+    unsigned int opt_threads : 1;
+
+    /* Set to 1 if option --stepmajor has been specified.  */
+    unsigned int opt_stepmajor : 1;
+
+    /* Set to 1 if option --incremental has been specified.  */
+    unsigned int opt_incremental : 1;
+
+    /* Set to 1 if option --lazy has been specified.  */
+    unsigned int opt_lazy : 1;
+
+    /* Set to 1 if option --sparse has been specified.  */
+    unsigned int opt_sparse : 1;
+
+    /* Set to 1 if option --matrixfree has been specified.  */
+    unsigned int opt_matrixfree : 1;
+
+    /* Set to 1 if option --compact has been specified.  */
+    unsigned int opt_compact : 1;
+
+    /* Set to 1 if option --kdtree has been specified.  */
+    unsigned int opt_kdtree : 1;
+
+    /* Set to 1 if option --powulps has been specified.  */
+    unsigned int opt_powulps : 1;
+    
     /* Set to 1 if option --optimum (-j) has been specified.  */
     unsigned int opt_optimum : 1;
 
@@ -207,6 +315,21 @@ struct options {
     /* Set to 1 if option --dlb (-d) has been specified.  */
     unsigned int opt_dlb : 1;
 
+    /* Set to 1 if option --dlbseed has been specified.  */
+    unsigned int opt_dlbseed : 1;
+
+    /* Set to 1 if option --twolevel has been specified.  */
+    unsigned int opt_twolevel : 1;
+
+    /* Set to 1 if option --lsants has been specified.  */
+    unsigned int opt_lsants : 1;
+
+    /* Set to 1 if option --lsdiff has been specified.  */
+    unsigned int opt_lsdiff : 1;
+
+    /* Set to 1 if option --lsbudget has been specified.  */
+    unsigned int opt_lsbudget : 1;
+
     /* Set to 1 if option --as (-u) has been specified.  */
     unsigned int opt_as : 1;
 
@@ -225,6 +348,12 @@ struct options {
     /* Set to 1 if option --acs (-z) has been specified.  */
     unsigned int opt_acs : 1;
 
+    /* Set to 1 if option --paco has been specified.  */
+    unsigned int opt_paco : 1;
+
+    /* Set to 1 if option --population has been specified.  */
+    unsigned int opt_population : 1;
+
     /* Set to 1 if option --log has been specified.  */
     unsigned int opt_log : 1;
 
@@ -252,9 +381,42 @@ struct options {
     /* Argument to option --ptries (-p).  */
     const char *arg_ptries;
 
+    /* Argument to option --partialsort.  */
+    const char *arg_partialsort;
+
+    /* Argument to option --packingcache.  */
+    const char *arg_packingcache;
+
     /* Argument to option --time (-t).  */
     const char *arg_time;
 
+    /* Argument to option --threads.  */
+    const char *arg_threads;
+
+    /* Argument to option --stepmajor.  */
+    const char *arg_stepmajor;
+
+    /* Argument to option --incremental.  */
+    const char *arg_incremental;
+
+    /* Argument to option --lazy.  */
+    const char *arg_lazy;
+
+    /* Argument to option --sparse.  */
+    const char *arg_sparse;
+
+    /* Argument to option --matrixfree.  */
+    const char *arg_matrixfree;
+
+    /* Argument to option --compact.  */
+    const char *arg_compact;
+
+    /* Argument to option --kdtree.  */
+    const char *arg_kdtree;
+
+    /* Argument to option --powulps.  */
+    const char *arg_powulps;
+
     /* Argument to option --optimum (-o).  */
     const char *arg_optimum;
 
@@ -282,6 +444,9 @@ struct options {
     /* Argument to option --rasranks (-f).  */
     const char *arg_rasranks;
 
+    /* Argument to option --population.  */
+    const char *arg_population;
+
     /* Argument to option --nnls (-k).  */
     const char *arg_nnls;
 
@@ -291,6 +456,21 @@ struct options {
     /* Argument to option --dlb (-d).  */
     const char *arg_dlb;
 
+    /* Argument to option --dlbseed.  */
+    const char *arg_dlbseed;
+
+    /* Argument to option --twolevel.  */
+    const char *arg_twolevel;
+
+    /* Argument to option --lsants.  */
+    const char *arg_lsants;
+
+    /* Argument to option --lsdiff.  */
+    const char *arg_lsdiff;
+
+    /* Argument to option --lsbudget.  */
+    const char *arg_lsbudget;
+
 };
 
 /* Parse command line options.  Return index of first non-option argument,
@@ -304,7 +484,18 @@ parse_options (struct options *const options, const char *const program_name,
     static const char *const optstr__tries = "tries";
     static const char *const optstr__tours = "tours";
     static const char *const optstr__ptries = "ptries";
+    static const char *const optstr__partialsort = "partialsort";
+    static const char *const optstr__packingcache = "packingcache";
     static const char *const optstr__time = "time";
+    static const char *const optstr__threads = "threads";
+    static const char *const optstr__stepmajor = "stepmajor";
+    static const char *const optstr__incremental = "incremental";
+    static const char *const optstr__lazy = "lazy";
+    static const char *const optstr__sparse = "sparse";
+    static const char *const optstr__matrixfree = "matrixfree";
+    static const char *const optstr__compact = "compact";
+    static const char *const optstr__kdtree = "kdtree";
+    static const char *const optstr__powulps = "powulps";
     static const char *const optstr__seed = "seed";
     static const char *const optstr__optimum = "optimum";
     static const char *const optstr__ants = "ants";
@@ -318,12 +509,19 @@ parse_options (struct options *const options, const char *const program_name,
     static const char *const optstr__nnls = "nnls";
     static const char *const optstr__localsearch = "localsearch";
     static const char *const optstr__dlb = "dlb";
+    static const char *const optstr__dlbseed = "dlbseed";
+    static const char *const optstr__twolevel = "twolevel";
+    static const char *const optstr__lsants = "lsants";
+    static const char *const optstr__lsdiff = "lsdiff";
+    static const char *const optstr__lsbudget = "lsbudget";
     static const char *const optstr__as = "as";
     static const char *const optstr__eas = "eas";
     static const char *const optstr__ras = "ras";
     static const char *const optstr__mmas = "mmas";
     static const char *const optstr__bwas = "bwas";
     static const char *const optstr__acs = "acs";
+    static const char *const optstr__paco = "paco";
+    static const char *const optstr__population = "population";
     static const char *const optstr__log = "log";
     static const char *const optstr__help = "help";
     static const char *const optstr__calibration = "calibration";
@@ -333,7 +531,18 @@ parse_options (struct options *const options, const char *const program_name,
     options->opt_tries = 0;
     options->opt_tours = 0;
     options->opt_ptries = 0;
+    options->opt_partialsort = 0;
+    options->opt_packingcache = 0;
     options->opt_time = 0;
+    options->opt_threads = 0;
+    options->opt_stepmajor = 0;
+    options->opt_incremental = 0;
+    options->opt_lazy = 0;
+    options->opt_sparse = 0;
+    options->opt_matrixfree = 0;
+    options->opt_compact = 0;
+    options->opt_kdtree = 0;
+    options->opt_powulps = 0;
     options->opt_seed = 0;    
     options->opt_optimum = 0;
     options->opt_ants = 0;
@@ -347,12 +556,19 @@ parse_options (struct options *const options, const char *const program_name,
     options->opt_nnls = 0;
     options->opt_localsearch = 0;
     options->opt_dlb = 0;
+    options->opt_dlbseed = 0;
+    options->opt_twolevel = 0;
+    options->opt_lsants = 0;
+    options->opt_lsdiff = 0;
+    options->opt_lsbudget = 0;
     options->opt_as = 0;
     options->opt_eas = 0;
     options->opt_ras = 0;
     options->opt_mmas = 0;
     options->opt_bwas = 0;
     options->opt_acs = 0;
+    options->opt_paco = 0;
+    options->opt_population = 0;
     options->opt_log = 0;
     options->opt_help = 0;
     options->opt_calibration = 0;  
@@ -362,7 +578,18 @@ parse_options (struct options *const options, const char *const program_name,
     options->arg_seed = 0;
     options->arg_tours = 0;    
     options->arg_ptries = 0;
+    options->arg_partialsort = 0;
+    options->arg_packingcache = 0;
     options->arg_time = 0;    
+    options->arg_threads = 0;
+    options->arg_stepmajor = 0;
+    options->arg_incremental = 0;
+    options->arg_lazy = 0;
+    options->arg_sparse = 0;
+    options->arg_matrixfree = 0;
+    options->arg_compact = 0;
+    options->arg_kdtree = 0;
+    options->arg_powulps = 0;
     options->arg_optimum = 0;
     options->arg_ants = 0;
     options->arg_nnants = 0;
@@ -372,9 +599,15 @@ parse_options (struct options *const options, const char *const program_name,
     options->arg_q0 = 0;
     options->arg_elitistants = 0;
     options->arg_rasranks = 0;
+    options->arg_population = 0;
     options->arg_nnls = 0;
     options->arg_localsearch = 0;
     options->arg_dlb = 0;
+    options->arg_dlbseed = 0;
+    options->arg_twolevel = 0;
+    options->arg_lsants = 0;
+    options->arg_lsdiff = 0;
+    options->arg_lsbudget = 0;
     while (++i < argc)
     {
         const char *option = argv [i];
@@ -496,6 +729,22 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_calibration = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__compact + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 1)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_compact = argument;
+                    else if (++i < argc)
+                        options->arg_compact = argv [i];
+                    else
+                    {
+                        option = optstr__compact;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_compact = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;
             case 'd':
                 if (strncmp (option + 1, optstr__dlb + 1, option_len - 1) == 0)
@@ -512,6 +761,20 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_dlb = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__dlbseed + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_dlbseed = argument;
+                    else if (++i < argc)
+                        options->arg_dlbseed = argv [i];
+                    else
+                    {
+                        option = optstr__dlbseed;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_dlbseed = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;
             case 'e':
                 if (strncmp (option + 1, optstr__eas + 1, option_len - 1) == 0)
@@ -572,7 +835,39 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_inputfile = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__incremental + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 1)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_incremental = argument;
+                    else if (++i < argc)
+                        options->arg_incremental = argv [i];
+                    else
+                    {
+                        option = optstr__incremental;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_incremental = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;                
+            case 'k':
+                if (strncmp (option + 1, optstr__kdtree + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_kdtree = argument;
+                    else if (++i < argc)
+                        options->arg_kdtree = argv [i];
+                    else
+                    {
+                        option = optstr__kdtree;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_kdtree = 1;
+                    break;
+                }
+                goto error_unknown_long_opt;
             case 'l':
                 if (strncmp (option + 1, optstr__localsearch + 1, option_len - 1) == 0)
                 {
@@ -598,6 +893,70 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_log = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__lazy + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 1)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_lazy = argument;
+                    else if (++i < argc)
+                        options->arg_lazy = argv [i];
+                    else
+                    {
+                        option = optstr__lazy;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_lazy = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__lsants + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 2)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_lsants = argument;
+                    else if (++i < argc)
+                        options->arg_lsants = argv [i];
+                    else
+                    {
+                        option = optstr__lsants;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_lsants = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__lsdiff + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 2)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_lsdiff = argument;
+                    else if (++i < argc)
+                        options->arg_lsdiff = argv [i];
+                    else
+                    {
+                        option = optstr__lsdiff;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_lsdiff = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__lsbudget + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 2)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_lsbudget = argument;
+                    else if (++i < argc)
+                        options->arg_lsbudget = argv [i];
+                    else
+                    {
+                        option = optstr__lsbudget;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_lsbudget = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;
             case 'm':
                 if (strncmp (option + 1, optstr__mmas + 1, option_len - 1) == 0)
@@ -610,6 +969,22 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_mmas = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__matrixfree + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 1)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_matrixfree = argument;
+                    else if (++i < argc)
+                        options->arg_matrixfree = argv [i];
+                    else
+                    {
+                        option = optstr__matrixfree;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_matrixfree = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;
             case 'n':
                 if (strncmp (option + 1, optstr__nnants + 1, option_len - 1) == 0)
@@ -662,6 +1037,76 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_ptries = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__partialsort + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_partialsort = argument;
+                    else if (++i < argc)
+                        options->arg_partialsort = argv [i];
+                    else
+                    {
+                        option = optstr__partialsort;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_partialsort = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__packingcache + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_packingcache = argument;
+                    else if (++i < argc)
+                        options->arg_packingcache = argv [i];
+                    else
+                    {
+                        option = optstr__packingcache;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_packingcache = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__powulps + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_powulps = argument;
+                    else if (++i < argc)
+                        options->arg_powulps = argv [i];
+                    else
+                    {
+                        option = optstr__powulps;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_powulps = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__paco + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 2)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                    {
+                        option = optstr__paco;
+                        goto error_unexpec_arg_long;
+                    }
+                    options->opt_paco = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__population + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 2)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_population = argument;
+                    else if (++i < argc)
+                        options->arg_population = argv [i];
+                    else
+                    {
+                        option = optstr__population;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_population = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;
             case 'o':
                 if (strncmp (option + 1, optstr__outputfile + 1, option_len - 1) == 0)
@@ -774,6 +1219,38 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_seed = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__stepmajor + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 1)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_stepmajor = argument;
+                    else if (++i < argc)
+                        options->arg_stepmajor = argv [i];
+                    else
+                    {
+                        option = optstr__stepmajor;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_stepmajor = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__sparse + 1, option_len - 1) == 0)
+                {
+                    if (option_len <= 1)
+                        goto error_long_opt_ambiguous;
+                    if (argument != 0)
+                        options->arg_sparse = argument;
+                    else if (++i < argc)
+                        options->arg_sparse = argv [i];
+                    else
+                    {
+                        option = optstr__sparse;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_sparse = 1;
+                    break;
+                }
                 goto error_unknown_long_opt;
             case 't':
                 if (strncmp (option + 1, optstr__time + 1, option_len - 1) == 0)
@@ -824,6 +1301,34 @@ parse_options (struct options *const options, const char *const program_name,
                     options->opt_tries = 1;
                     break;
                 }
+                else if (strncmp (option + 1, optstr__threads + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_threads = argument;
+                    else if (++i < argc)
+                        options->arg_threads = argv [i];
+                    else
+                    {
+                        option = optstr__threads;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_threads = 1;
+                    break;
+                }
+                else if (strncmp (option + 1, optstr__twolevel + 1, option_len - 1) == 0)
+                {
+                    if (argument != 0)
+                        options->arg_twolevel = argument;
+                    else if (++i < argc)
+                        options->arg_twolevel = argv [i];
+                    else
+                    {
+                        option = optstr__twolevel;
+                        goto error_missing_arg_long;
+                    }
+                    options->opt_twolevel = 1;
+                    break;
+                }
             default:
                 error_unknown_long_opt:
                 fprintf (stderr, STR_ERR_UNKNOWN_LONG_OPT, program_name, option);
@@ -1237,12 +1742,12 @@ int parse_commandline (int argc, char *argv [])
     }
 
     if (options.opt_as + options.opt_eas + options.opt_ras + options.opt_mmas
-            + options.opt_bwas + options.opt_acs > 1) {
+            + options.opt_bwas + options.opt_acs + options.opt_paco > 1) {
         fprintf (stderr, "error: more than one ACO algorithm enabled in the command line");
         exit (1);
     } else if (options.opt_as + options.opt_eas + options.opt_ras + options.opt_mmas
-            + options.opt_bwas + options.opt_acs == 1)  {
-        as_flag = eas_flag = ras_flag = mmas_flag = bwas_flag = acs_flag = FALSE;
+            + options.opt_bwas + options.opt_acs + options.opt_paco == 1)  {
+        as_flag = eas_flag = ras_flag = mmas_flag = bwas_flag = acs_flag = paco_flag = FALSE;
     }
 
     if (options.opt_as || as_flag) {
@@ -1281,6 +1786,11 @@ int parse_commandline (int argc, char *argv [])
         /*fprintf(stdout,"acs_flag is set to 1, run Ant Colony System\n");*/
     }
 
+    if ( options.opt_paco || paco_flag ) {
+        paco_flag = TRUE;
+        set_default_paco_parameters();
+    }
+
     if ( options.opt_localsearch ) {
         ls_flag = atol(options.arg_localsearch);
         /*
@@ -1288,7 +1798,7 @@ int parse_commandline (int argc, char *argv [])
         if (options.arg_localsearch != NULL)
             printf ("with argument \"%ld\"\n", ls_flag);
         */
-        check_out_of_range(ls_flag, 0, 3, "ls_flag");
+        check_out_of_range(ls_flag, 0, 5, "ls_flag");
     } 
     /*
     else {
@@ -1305,6 +1815,9 @@ int parse_commandline (int argc, char *argv [])
         case 3:
             fprintf(stdout,"\tNote: local search flag is set to default 3 (3-opt)\n");
             break;
+        case 4:
+            fprintf(stdout,"\tNote: local search flag is set to default 4 (2-opt and Or-opt)\n");
+            break;
         default:
             abort();
         }
@@ -1353,6 +1866,72 @@ int parse_commandline (int argc, char *argv [])
     }
     */
 
+    if ( options.opt_partialsort ) {
+        partial_sort_flag = atol(options.arg_partialsort);
+        check_out_of_range( partial_sort_flag, 0, 1, "partialsort");
+    } 
+
+    if ( options.opt_packingcache ) {
+        packing_cache_size = atol(options.arg_packingcache);
+        check_out_of_range( packing_cache_size, 0, 1048576, "packingcache");
+    } 
+
+    if ( options.opt_threads ) {
+        n_threads = atol(options.arg_threads);
+        check_out_of_range( n_threads, 1, MAX_THREADS, "threads");
+    } 
+    /* the CPU time of all threads adds up, hence the time limit refers to real time */
+    if ( n_threads > 1 ) {
+        timer_type = REAL;
+    }
+
+    if ( options.opt_stepmajor ) {
+        step_major_flag = atol(options.arg_stepmajor);
+        check_out_of_range( step_major_flag, 0, 1, "stepmajor");
+    } 
+    /* the local pheromone update of ACS needs all ants to move in step */
+    if ( acs_flag ) {
+        step_major_flag = TRUE;
+    }
+
+    if ( options.opt_incremental ) {
+        incremental_flag = atol(options.arg_incremental);
+        check_out_of_range( incremental_flag, 0, 1, "incremental");
+    } 
+    if ( options.opt_lazy ) {
+        lazy_flag = atol(options.arg_lazy);
+        check_out_of_range( lazy_flag, 0, 1, "lazy");
+    } 
+    if ( options.opt_sparse ) {
+        sparse_flag = atol(options.arg_sparse);
+        check_out_of_range( sparse_flag, 0, 1, "sparse");
+    } 
+    if ( options.opt_matrixfree ) {
+        matrix_free_flag = atol(options.arg_matrixfree);
+        check_out_of_range( matrix_free_flag, 0, 1, "matrixfree");
+    } 
+    if ( options.opt_compact ) {
+        compact_flag = atol(options.arg_compact);
+        check_out_of_range( compact_flag, 0, 1, "compact");
+    } 
+    if ( options.opt_kdtree ) {
+        kd_tree_flag = atol(options.arg_kdtree);
+        check_out_of_range( kd_tree_flag, 0, 1, "kdtree");
+    } 
+    if ( options.opt_powulps ) {
+        pow_ulps = atof(options.arg_powulps);
+        check_out_of_range( pow_ulps, 0., 1e15, "powulps");
+    } 
+
+    /* ACS and P-ACO already update single arcs; BWAS mutates and lowers trails of arbitrary arcs */
+    if ( acs_flag || bwas_flag || paco_flag ) {
+        incremental_flag = FALSE;
+    }
+    /* ACS and P-ACO have no evaporation of all trails */
+    if ( acs_flag || paco_flag ) {
+        lazy_flag = FALSE;
+    }
+
     if ( options.opt_nnants ) {
         nn_ants = atol(options.arg_nnants);
         /*
@@ -1456,12 +2035,18 @@ int parse_commandline (int argc, char *argv [])
         */
         check_out_of_range( ras_ranks, 0, LONG_MAX, "rasranks");
     } 
+
     /*
     else {
         fprintf(stdout,"\tNote: number of ranks is set to default %ld\n", ras_ranks);
     }
     */
 
+    if ( options.opt_population ) {
+        paco_size = atol(options.arg_population);
+        check_out_of_range( paco_size, 1, LONG_MAX, "population");
+    } 
+
     if ( options.opt_nnls ) {
         nn_ls = atol(options.arg_nnls);
         /*
@@ -1492,6 +2077,31 @@ int parse_commandline (int argc, char *argv [])
                 dlb_flag ? 1 : 0, dlb_flag ? "use" : "not use");
     }
     */
+
+    if ( options.opt_dlbseed ) {
+        dlb_seed_flag = atol(options.arg_dlbseed);
+        check_out_of_range( dlb_seed_flag, 0, 1, "dlbseed");
+    } 
+
+    if ( options.opt_twolevel ) {
+        two_level_size = atol(options.arg_twolevel);
+        check_out_of_range( two_level_size, 0, LONG_MAX, "twolevel");
+    } 
+
+    if ( options.opt_lsants ) {
+        ls_ants = atol(options.arg_lsants);
+        check_out_of_range( ls_ants, 0, MAX_ANTS-1, "lsants");
+    } 
+
+    if ( options.opt_lsdiff ) {
+        ls_diff = atol(options.arg_lsdiff);
+        check_out_of_range( ls_diff, -1, LONG_MAX, "lsdiff");
+    } 
+
+    if ( options.opt_lsbudget ) {
+        ls_budget_flag = atol(options.arg_lsbudget);
+        check_out_of_range( ls_budget_flag, 0, 1, "lsbudget");
+    } 
     
     /*puts ("Non-option arguments:");*/
 
@@ -0,0 +1,175 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+import os
+import subprocess
+import argparse
+import time
+import tempfile
+import sys
+
+instances = {
+"eil51": ["eil51_01_bsc_01_01", "eil51_03_unc_05_02", "eil51_05_usw_10_03", "eil51_10_unc_10_03", ],
+"a280": ["a280_01_bsc_01_01", "a280_03_unc_05_02", "a280_05_usw_10_03", "a280_10_unc_10_03", ],
+"dsj1000": ["dsj1000_01_bsc_01_01", "dsj1000_03_unc_05_02", "dsj1000_05_usw_10_03", "dsj1000_10_unc_10_03", ],
+}
+
+# each benchmark compares several variants of the same run; every variant is a set of extra parameters.
+# "instances" optionally restricts a benchmark to the instances whose name contains it. Changes that
+# cannot be switched off by a parameter are compared by running the same benchmark on both trees.
+# "report" selects what is measured (default "time"): "time" is the wall-clock time of a run, the
+# others are read from its log file, "tours/sec" is the construction throughput, "nn time" the
+# time taken to build the candidate lists and "ls time" the time spent in the local search
+reports = {
+"time": ("time (s)", "%10.2f"),
+"tours/sec": ("tours/sec", "%10.1f"),
+"nn time": ("nn time (s)", "%10.3f"),
+"ls time": ("ls time (s)", "%10.2f"),
+}
+
+benchmarks = {
+"sort": {"families": ["a280", "dsj1000", ],
+         "parameters": "--mmas --ants 50 --ptries 5 --localsearch 0",
+         "variants": {"full quicksort": "--partialsort 0", "partial sort": "--partialsort 1", }, },
+"cache": {"families": ["a280", "dsj1000", ],
+          "parameters": "--mmas --ants 50 --ptries 5 --localsearch 1",
+          "variants": {"no cache": "--packingcache 0", "cache": "--packingcache 4096", }, },
+"construction": {"families": ["a280", "dsj1000", ],
+                 "parameters": "--mmas --ants 1000 --localsearch 0",
+                 "report": "tours/sec",
+                 "variants": {"ant-major": "--stepmajor 0", "step-major": "--stepmajor 1", }, },
+"threads": {"families": ["a280", "dsj1000", ],
+            "parameters": "--mmas --ants 100 --localsearch 0",
+            "report": "tours/sec",
+            "variants": {"1 thread": "--threads 1", "2 threads": "--threads 2", "4 threads": "--threads 4", "8 threads": "--threads 8", }, },
+"nnlists": {"families": ["a280", "dsj1000", ],
+            "parameters": "--mmas --ants 10 --localsearch 1",
+            "report": "nn time",
+            "variants": {"full sort": "--kdtree 0", "k-d tree": "--kdtree 1", "k-d tree, 4 threads": "--kdtree 1 --threads 4", }, },
+"powulps": {"families": ["a280", "dsj1000", ],
+            "parameters": "--mmas --ants 100 --alpha 1.5 --localsearch 0",
+            "variants": {"exact pow": "--powulps 0", "table, 8 ulps": "--powulps 8", }, },
+"matrixfree": {"families": ["a280", "dsj1000", ],
+               "parameters": "--mmas --ants 50 --localsearch 1",
+               "variants": {"distance matrix": "--matrixfree 0", "on demand": "--matrixfree 1", }, },
+"compact": {"families": ["a280", "dsj1000", ],
+            "parameters": "--mmas --ants 50 --localsearch 1 --matrixfree 0",
+            "variants": {"64 bits": "--compact 0", "32 bits": "--compact 1", }, },
+"shorttours": {"families": ["eil51", "a280", "dsj1000", ], "instances": "_01_",
+               "parameters": "--ants 10 --localsearch 0",
+               "report": "tours/sec",
+               "variants": {"ACS": "--acs", "MMAS": "--mmas", }, },
+"deposit": {"families": ["eil51", "a280", "dsj1000", ], "instances": "_01_",
+            "parameters": "--as --ants 10 --localsearch 0",
+            "variants": {"evaporation": "--lazy 0", "lazy evaporation": "--lazy 1", }, },
+"twolevel": {"families": ["dsj1000", ],
+             "parameters": "--mmas --ants 10",
+             "report": "ls time",
+             "variants": {"2-opt array": "--localsearch 1 --twolevel 0", "2-opt list": "--localsearch 1 --twolevel 1",
+                          "Or-opt array": "--localsearch 4 --twolevel 0", "Or-opt list": "--localsearch 4 --twolevel 1",
+                          "3-opt array": "--localsearch 3 --twolevel 0", "3-opt list": "--localsearch 3 --twolevel 1", }, },
+}
+
+# each parity check runs the same parameters with several numbers of threads; every try has to
+# give the same best profit for all of them, since the random numbers do not depend on the threads
+parity_checks = {
+"tries": {"families": ["a280", ],
+          "parameters": "--mmas --ants 20 --localsearch 1",
+          "tries": 4, "threads": [1, 4, ], },
+"construction": {"families": ["a280", ],
+                 "parameters": "--mmas --ants 20 --localsearch 0",
+                 "tries": 3, "threads": [1, 2, 3, 8, ], },
+"localsearch": {"families": ["a280", ],
+                "parameters": "--mmas --ants 20 --localsearch 3",
+                "tries": 3, "threads": [1, 2, 3, 8, ], },
+"bwas": {"families": ["a280", ],
+         "parameters": "--bwas --ants 20 --localsearch 4",
+         "tries": 3, "threads": [1, 2, 3, 8, ], },
+"acs": {"families": ["a280", ],
+        "parameters": "--acs --ants 10 --localsearch 1",
+        "tries": 3, "threads": [1, 2, 3, 8, ], },
+}
+
+def read_log(log, report):
+    for line in log:
+        words = line.split()
+        if report == "tours/sec" and "tours/sec" in words:
+            return float(words[words.index("tours/sec") - 1])
+        if report == "nn time" and line.startswith("nearest neighbour lists"):
+            return float(words[words.index("seconds") - 1])
+        if report == "ls time" and line.startswith("local search:"):
+            return float(words[words.index("seconds") - 1])
+    raise ValueError("no %s in the log file" % report)
+
+def run(inputfile, parameters, seed, tours, report="time"):
+    outputfile = tempfile.mktemp()
+    start = time.time()
+    output = subprocess.check_output("./acothop --tries 1 --time 0 --tours %d --seed %d --inputfile %s --outputfile %s --log %s" % (tours, seed, inputfile, outputfile, parameters), shell=True)
+    elapsed = time.time() - start
+    profit = int(output.decode().split()[-1])
+    if report != "time":
+        with open(outputfile + ".log") as log:
+            elapsed = read_log(log, report)
+    os.remove(outputfile)
+    os.remove(outputfile + ".log")
+    return profit, elapsed
+
+def run_tries(inputfile, parameters, seed, tours, tries):
+    outputfile = tempfile.mktemp()
+    subprocess.check_output("./acothop --tries %d --time 0 --tours %d --seed %d --inputfile %s --outputfile %s --log %s" % (tries, tours, seed, inputfile, outputfile, parameters), shell=True)
+    with open(outputfile + ".log") as log:
+        profits = [int(line.split()[3].rstrip(",")) for line in log if line.startswith("try ")]
+    os.remove(outputfile)
+    os.remove(outputfile + ".log")
+    return profits
+
+def check_parity(check, tours, runs):
+    print("%-25s %-10s %s" % ("instance", "threads", "best profit of each try"))
+    equal = True
+    for family in check["families"]:
+        for instance in instances[family]:
+            inputfile = "../../instances/%s-thop/%s.thop" % (family, instance)
+            for seed in range(1, runs + 1):
+                reference = None
+                for threads in check["threads"]:
+                    profits = run_tries(inputfile, check["parameters"] + " --threads %d" % threads, seed, tours, check["tries"])
+                    reference = reference or profits
+                    print("%-25s %-10d %s%s" % (instance, threads, " ".join(str(p) for p in profits), "" if profits == reference else "  MISMATCH"))
+                    equal = equal and profits == reference
+    return equal
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(description="Compare the running time of variants of ACO++ on fixed seeds")
+    parser.add_argument("--benchmark", choices=sorted(benchmarks.keys()), default="sort")
+    parser.add_argument("--tours", type=int, default=1000, help="number of tours constructed in each run")
+    parser.add_argument("--runs", type=int, default=3, help="number of runs (seeds) per instance and variant")
+    parser.add_argument("--inputfile", action="append", help="run on this instance (may be repeated) instead of the ones of the benchmark, e.g. a larger generated instance")
+    parser.add_argument("--parity", choices=sorted(parity_checks.keys()), help="check that the number of threads does not change the results instead")
+    args = parser.parse_args()
+
+    os.system("make")
+
+    if args.parity:
+        sys.exit(0 if check_parity(parity_checks[args.parity], args.tours, args.runs) else 1)
+
+    benchmark = benchmarks[args.benchmark]
+    report = benchmark.get("report", "time")
+    header, value_format = reports[report]
+    print("%-25s %-20s %12s %10s" % ("instance", "variant", "best profit", header))
+
+    if args.inputfile:
+        inputfiles = [(os.path.splitext(os.path.basename(inputfile))[0], inputfile) for inputfile in args.inputfile]
+    else:
+        inputfiles = [(instance, "../../instances/%s-thop/%s.thop" % (family, instance))
+                      for family in benchmark["families"] for instance in instances[family]
+                      if benchmark.get("instances", "") in instance]
+
+    for instance, inputfile in inputfiles:
+        for variant, extra_parameters in benchmark["variants"].items():
+            best_profit, total = 0, 0.0
+            for seed in range(1, args.runs + 1):
+                profit, measured = run(inputfile, benchmark["parameters"] + " " + extra_parameters, seed, args.tours, report)
+                best_profit = max(best_profit, profit)
+                total += measured
+            print(("%-25s %-20s %12d " + value_format) % (instance, variant, best_profit, total / args.runs))
@@ -56,17 +56,37 @@
 #include <math.h>
 #include <limits.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "inout.h"
 #include "thop.h"
 #include "ants.h"
 #include "ls.h"
 #include "utilities.h"
+#include "threads.h"
 
 #define M_PI 3.14159265358979323846264
 
 struct problem instance;
 
+__thread struct packing_workspace *packing_ws;
+
+
+long int packing_cache_size = 0;
+long int packing_cache_hits = 0;
+long int packing_cache_misses = 0;
+
+struct packing_cache_entry {
+    unsigned long long key;           /* hash of the tour, 0 if the entry is empty */
+    long int           tour_size;     /* size of the tour */
+    long int           fitness;       /* fitness of the best packing plan found for the tour */
+    unsigned long long *plan;         /* best packing plan found for the tour, one bit per item */
+};
+
+static struct packing_cache_entry *packing_cache = NULL;
+static long int plan_words;           /* number of 64-bit words of a packing plan in the cache */
+static pthread_mutex_t packing_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static double dtrunc (double x)
 {
     int k;
@@ -218,17 +238,535 @@ long int** compute_distances(void)
 }
 
 
-long int** compute_nn_lists( void )
+/* Above MATRIX_FREE_MIN_CITIES cities the n x n distance matrix is not computed 
+   (instance.distance is NULL). instance_distance then evaluates the distance 
+   function from the coordinates, including the distances of the dummy node n-1 as 
+   set by compute_distances, and loops over all cities of a row use distance_row, 
+   which keeps the rows used last in a small cache per thread. */
+
+long int matrix_free_flag;      /* = 1, distances are computed on demand */
+long int compact_flag;          /* = 1, distances are stored in 32 bits if they fit */
+long int kd_tree_flag;          /* = 1, candidate lists are built with a k-d tree */
+
+static long int dummy_distance; /* distance of the dummy node n-1 to all cities but 0 and n-2 */
+
+struct distance_cache {
+    long int      city[DISTANCE_CACHE_ROWS];      /* city of each cached row, -1 if unused */
+    long int      last_use[DISTANCE_CACHE_ROWS];  /* time stamp of the last use of each row */
+    long int      clock;
+    long int      **row;
+};
+
+static __thread struct distance_cache *distance_cache;
+
+static int compare_points( const void *a, const void *b )
 /*    
-      FUNCTION: computes nearest neighbor lists of depth nn for each city
+      FUNCTION: orders node indices by x and then by y coordinate
+      INPUT:    pointers to two node indices
+      OUTPUT:   negative, zero or positive as for qsort
+ */
+{
+    struct point *p = &instance.nodeptr[*(const long int *) a];
+    struct point *q = &instance.nodeptr[*(const long int *) b];
+
+    if ( p->x != q->x )
+        return p->x < q->x ? -1 : 1;
+    if ( p->y != q->y )
+        return p->y < q->y ? -1 : 1;
+    return 0;
+}
+
+static double cross( long int o, long int a, long int b )
+/*    
+      FUNCTION: cross product of the vectors from node o to nodes a and b
+      INPUT:    three node indices
+      OUTPUT:   positive if o, a, b make a counter-clockwise turn
+ */
+{
+    struct point *p = instance.nodeptr;
+
+    return (p[a].x - p[o].x) * (p[b].y - p[o].y) - (p[a].y - p[o].y) * (p[b].x - p[o].x);
+}
+
+static long int max_distance( void )
+/*    
+      FUNCTION: computes the largest distance between two cities other than the dummy node
       INPUT:    none
-      OUTPUT:   pointer to the nearest neighbor lists
+      OUTPUT:   largest distance
+      COMMENTS: the Euclidean based distances grow with the Euclidean distance, so the 
+                farthest pair is found among the vertices of the convex hull (Andrew's 
+                monotone chain); for GEO distances all pairs are checked
+ */
+{
+    long int    i, j, k, h, n = instance.n - 1;
+    long int    *order, *hull;
+    long int    max = 0;
+
+    if ( distance == geo_distance ) {
+        for ( i = 0 ; i < n ; i++ ) {
+            for ( j = 0 ; j < n ; j++ ) {
+                max = MAX(max, distance(i, j));
+            }
+        }
+        return max;
+    }
+
+    order = (long int *) malloc( n * sizeof(long int) );
+    hull = (long int *) malloc( 2 * (n + 1) * sizeof(long int) );
+    if ( order == NULL || hull == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < n ; i++ )
+        order[i] = i;
+    qsort( order, n, sizeof(long int), compare_points );
+
+    k = 0;
+    for ( i = 0 ; i < n ; i++ ) {                 /* lower hull */
+        while ( k >= 2 && cross( hull[k-2], hull[k-1], order[i] ) <= 0 )
+            k--;
+        hull[k++] = order[i];
+    }
+    for ( i = n - 2, h = k + 1 ; i >= 0 ; i-- ) { /* upper hull */
+        while ( k >= h && cross( hull[k-2], hull[k-1], order[i] ) <= 0 )
+            k--;
+        hull[k++] = order[i];
+    }
+
+    for ( i = 0 ; i < k ; i++ ) {
+        for ( j = i + 1 ; j < k ; j++ ) {
+            max = MAX(max, distance(hull[i], hull[j]));
+        }
+    }
+    free( order );
+    free( hull );
+    return max;
+}
+
+int ** compute_compact_distances( void )
+/*    
+      FUNCTION: computes the matrix of all intercity distances with 32 bit entries
+      INPUT:    none
+      OUTPUT:   pointer to distance matrix, has to be freed when program stops; 
+                NULL if some distance does not fit into 32 bits
+      COMMENTS: the largest entry is the distance of the dummy node, which is known 
+                before the matrix is allocated
+ */
+{
+    long int     i, j;
+    int          **matrix;
+
+    init_distance_on_demand();
+    if ( dummy_distance > INT_MAX )
+        return NULL;
+
+    if((matrix = (int **) malloc(sizeof(int) * instance.n * instance.n + sizeof(int *) * instance.n)) == NULL){
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < instance.n ; i++ ) {
+        matrix[i] = (int *)(matrix + instance.n) + i * instance.n;
+        for ( j = 0 ; j < instance.n ; j++ ) {
+            matrix[i][j] = (int) distance_on_demand( i, j );
+        }
+    }
+    return matrix;
+}
+
+void init_distance_on_demand( void )
+/*    
+      FUNCTION: prepares the computation of distances without distance matrix
+      INPUT:    none
+      OUTPUT:   none
+      (SIDE)EFFECTS: the distance of the dummy node is set as in compute_distances
+ */
+{
+    dummy_distance = max_distance() * ( instance.n - 1 );
+}
+
+long int distance_on_demand( long int i, long int j )
+/*    
+      FUNCTION: computes the distance between two cities without distance matrix
+      INPUT:    two city indices
+      OUTPUT:   their distance, the same as in the matrix of compute_distances
+ */
+{
+    long int    dummy = instance.n - 1;
+    long int    other;
+
+    if ( i == dummy || j == dummy ) {
+        other = ( i == dummy ) ? j : i;
+        if ( other == 0 || other == instance.n - 2 )
+            return 0;   /* the dummy node joins the first and the last city */
+        return dummy_distance;
+    }
+    return distance(i, j);
+}
+
+const long int * distance_row( long int i )
+/*    
+      FUNCTION: gives the distances from city i to all cities
+      INPUT:    city index
+      OUTPUT:   pointer to row i of the distance matrix, or to a cached copy of it
+      COMMENTS: rows of the compact matrix are widened in the cache as well; the cache of the calling thread keeps the DISTANCE_CACHE_ROWS rows used 
+                last; the row is valid until the next DISTANCE_CACHE_ROWS calls
+ */
+{
+    long int    j, r, victim;
+    struct distance_cache *c;
+
+    if ( instance.distance != NULL )
+        return instance.distance[i];
+
+    if ( (c = distance_cache) == NULL ) {
+        if ( (c = (struct distance_cache *) malloc( sizeof(struct distance_cache) )) == NULL ) {
+            fprintf(stderr,"Out of memory, exit.");
+            exit(1);
+        }
+        c->row = generate_int_matrix( DISTANCE_CACHE_ROWS, instance.n );
+        for ( r = 0 ; r < DISTANCE_CACHE_ROWS ; r++ ) {
+            c->city[r] = -1;
+            c->last_use[r] = 0;
+        }
+        c->clock = 0;
+        distance_cache = c;
+    }
+
+    c->clock++;
+    victim = 0;
+    for ( r = 0 ; r < DISTANCE_CACHE_ROWS ; r++ ) {
+        if ( c->city[r] == i ) {
+            c->last_use[r] = c->clock;
+            return c->row[r];
+        }
+        if ( c->last_use[r] < c->last_use[victim] )
+            victim = r;
+    }
+    for ( j = 0 ; j < instance.n ; j++ ) {
+        c->row[victim][j] = instance_distance( i, j );
+    }
+    c->city[victim] = i;
+    c->last_use[victim] = c->clock;
+    return c->row[victim];
+}
+
+void free_distance_cache( void )
+/*    
+      FUNCTION: frees the row cache of the calling thread
+      INPUT:    none
+      OUTPUT:   none
+ */
+{
+    if ( distance_cache == NULL )
+        return;
+    free( distance_cache->row );
+    free( distance_cache );
+    distance_cache = NULL;
+}
+
+
+/* The candidate lists of the Euclidean based distances are built with a k-d tree 
+   over the cities 0 .. n-2; the dummy node n-1 has no coordinates and is added to 
+   the candidates of every city explicitly. Neighbours at the same distance are 
+   ordered by their index. */
+
+#define KD_ROUNDING_SLACK  4.0  /* Euclidean distances with the same rounded distance differ by less (ATT: sqrt(10)) */
+
+static long int *kd_city;       /* cities in the order of the implicit tree, the root of [lo,hi) is at (lo+hi)/2 */
+static char     *kd_dim;        /* split coordinate of each tree node, 0: x, 1: y */
+static int      **nn_lists;     /* candidate lists under construction */
+static long int nn_depth;       /* their length */
+
+struct kd_query {
+    long int      city;         /* city whose neighbours are searched */
+    long int      k;            /* number of nearest cities searched */
+    long int      size;         /* number of cities in the heap */
+    double        *heap_d;      /* max-heap of the squared Euclidean distances of the k nearest cities */
+    long int      *heap_c;
+    long int      n_found;      /* cities within the search radius */
+    long int      max_found;
+    long int      *found;
+};
+
+struct neighbour {
+    long int      distance;
+    long int      city;
+};
+
+static double coordinate( long int c, long int dim )
+{
+    return dim ? instance.nodeptr[c].y : instance.nodeptr[c].x;
+}
+
+static double squared_euclid( long int a, long int b )
+{
+    double xd = instance.nodeptr[a].x - instance.nodeptr[b].x;
+    double yd = instance.nodeptr[a].y - instance.nodeptr[b].y;
+
+    return xd * xd + yd * yd;
+}
+
+static void kd_build( long int lo, long int hi )
+/*    
+      FUNCTION: builds the k-d tree of the cities kd_city[lo] .. kd_city[hi-1]
+      INPUT:    range of kd_city
+      OUTPUT:   none
+      COMMENTS: each node splits along the coordinate with the larger spread; the 
+                median is placed at (lo+hi)/2 by quickselect
+ */
+{
+    long int    i, j, l, r, m, dim, help;
+    double      min_x, max_x, min_y, max_y, pivot;
+
+    if ( hi - lo <= 0 )
+        return;
+    m = (lo + hi) / 2;
+    min_x = max_x = instance.nodeptr[kd_city[lo]].x;
+    min_y = max_y = instance.nodeptr[kd_city[lo]].y;
+    for ( i = lo + 1 ; i < hi ; i++ ) {
+        min_x = MIN(min_x, instance.nodeptr[kd_city[i]].x);
+        max_x = MAX(max_x, instance.nodeptr[kd_city[i]].x);
+        min_y = MIN(min_y, instance.nodeptr[kd_city[i]].y);
+        max_y = MAX(max_y, instance.nodeptr[kd_city[i]].y);
+    }
+    dim = ( max_y - min_y > max_x - min_x );
+
+    l = lo;
+    r = hi - 1;
+    while ( l < r ) {
+        pivot = coordinate( kd_city[m], dim );
+        i = l;
+        j = r;
+        do {
+            while ( coordinate( kd_city[i], dim ) < pivot ) i++;
+            while ( pivot < coordinate( kd_city[j], dim ) ) j--;
+            if ( i <= j ) {
+                help = kd_city[i];
+                kd_city[i] = kd_city[j];
+                kd_city[j] = help;
+                i++;
+                j--;
+            }
+        } while ( i <= j );
+        if ( j < m ) l = i;
+        if ( m < i ) r = j;
+    }
+    kd_dim[m] = (char) dim;
+    kd_build( lo, m );
+    kd_build( m + 1, hi );
+}
+
+static void heap_offer( struct kd_query *q, double d, long int c )
+/*    
+      FUNCTION: offers a city to the heap of the k nearest cities
+      INPUT:    query, squared distance and city
+      OUTPUT:   none
+ */
+{
+    long int    i, child;
+
+    if ( q->size == q->k ) {
+        if ( d >= q->heap_d[0] )
+            return;
+        /* replace the farthest city and sift it down */
+        i = 0;
+        for ( ; ; ) {
+            child = 2 * i + 1;
+            if ( child >= q->size )
+                break;
+            if ( child + 1 < q->size && q->heap_d[child+1] > q->heap_d[child] )
+                child++;
+            if ( q->heap_d[child] <= d )
+                break;
+            q->heap_d[i] = q->heap_d[child];
+            q->heap_c[i] = q->heap_c[child];
+            i = child;
+        }
+    } else {
+        i = q->size++;
+        while ( i > 0 && q->heap_d[(i-1)/2] < d ) {
+            q->heap_d[i] = q->heap_d[(i-1)/2];
+            q->heap_c[i] = q->heap_c[(i-1)/2];
+            i = (i - 1) / 2;
+        }
+    }
+    q->heap_d[i] = d;
+    q->heap_c[i] = c;
+}
+
+static void kd_nearest( struct kd_query *q, long int lo, long int hi )
+/*    
+      FUNCTION: searches the k cities nearest to q->city in the subtree of [lo,hi)
+      INPUT:    query and range of kd_city
+      OUTPUT:   none
+ */
+{
+    long int    m, c;
+    double      diff;
+
+    if ( hi - lo <= 0 )
+        return;
+    m = (lo + hi) / 2;
+    c = kd_city[m];
+    if ( c != q->city )
+        heap_offer( q, squared_euclid( q->city, c ), c );
+    diff = coordinate( q->city, kd_dim[m] ) - coordinate( c, kd_dim[m] );
+    if ( diff < 0 ) {
+        kd_nearest( q, lo, m );
+        if ( q->size < q->k || diff * diff <= q->heap_d[0] )
+            kd_nearest( q, m + 1, hi );
+    } else {
+        kd_nearest( q, m + 1, hi );
+        if ( q->size < q->k || diff * diff <= q->heap_d[0] )
+            kd_nearest( q, lo, m );
+    }
+}
+
+static void kd_range( struct kd_query *q, long int lo, long int hi, double r2 )
+/*    
+      FUNCTION: collects the cities within squared Euclidean distance r2 of q->city
+      INPUT:    query, range of kd_city and squared radius
+      OUTPUT:   none
+ */
+{
+    long int    m, c;
+    double      diff;
+
+    if ( hi - lo <= 0 )
+        return;
+    m = (lo + hi) / 2;
+    c = kd_city[m];
+    if ( c != q->city && squared_euclid( q->city, c ) <= r2 ) {
+        if ( q->n_found == q->max_found ) {
+            q->max_found *= 2;
+            if ( (q->found = (long int *) realloc( q->found, q->max_found * sizeof(long int) )) == NULL ) {
+                fprintf(stderr,"Out of memory, exit.");
+                exit(1);
+            }
+        }
+        q->found[q->n_found++] = c;
+    }
+    diff = coordinate( q->city, kd_dim[m] ) - coordinate( c, kd_dim[m] );
+    if ( diff <= 0 || diff * diff <= r2 )
+        kd_range( q, lo, m, r2 );
+    if ( diff >= 0 || diff * diff <= r2 )
+        kd_range( q, m + 1, hi, r2 );
+}
+
+static int compare_neighbours( const void *a, const void *b )
+{
+    const struct neighbour *p = (const struct neighbour *) a;
+    const struct neighbour *q = (const struct neighbour *) b;
+
+    if ( p->distance != q->distance )
+        return p->distance < q->distance ? -1 : 1;
+    return p->city < q->city ? -1 : (p->city > q->city);
+}
+
+static void kd_nn_list( long int node )
+/*    
+      FUNCTION: computes the candidate list of one city with the k-d tree
+      INPUT:    city index
+      OUTPUT:   none
+      (SIDE)EFFECTS: row node of nn_lists is set
+      COMMENTS: the k nearest cities by Euclidean distance give the radius within which 
+                all cities with a rounded distance up to the one of the k-th are found; 
+                these and the dummy node are sorted by distance and index
  */
 {
-    long int i, node, nn;
+    long int    i, dummy = instance.n - 1;
+    double      radius;
+    struct kd_query q;
+    struct neighbour *cand;
+
+    if ( node == dummy ) {
+        /* distance 0 to the first and the last city, the same distance to all others */
+        nn_lists[node][0] = 0;
+        nn_lists[node][1] = instance.n - 2;
+        for ( i = 2 ; i < nn_depth ; i++ )
+            nn_lists[node][i] = i - 1;
+        return;
+    }
+
+    q.city = node;
+    q.k = MIN(nn_depth, instance.n - 2);
+    q.size = 0;
+    q.heap_d = (double *) malloc( q.k * sizeof(double) );
+    q.heap_c = (long int *) malloc( q.k * sizeof(long int) );
+    q.n_found = 0;
+    q.max_found = 2 * q.k + 1;
+    q.found = (long int *) malloc( q.max_found * sizeof(long int) );
+    if ( q.heap_d == NULL || q.heap_c == NULL || q.found == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+
+    kd_nearest( &q, 0, instance.n - 1 );
+    radius = sqrt( q.heap_d[0] ) + KD_ROUNDING_SLACK;
+    kd_range( &q, 0, instance.n - 1, radius * radius * (1. + 1e-12) );
+
+    if ( (cand = (struct neighbour *) malloc( (q.n_found + 1) * sizeof(struct neighbour) )) == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < q.n_found ; i++ ) {
+        cand[i].city = q.found[i];
+        cand[i].distance = instance_distance( node, q.found[i] );
+    }
+    cand[i].city = dummy;
+    cand[i].distance = instance_distance( node, dummy );
+    qsort( cand, q.n_found + 1, sizeof(struct neighbour), compare_neighbours );
+    for ( i = 0 ; i < nn_depth ; i++ )
+        nn_lists[node][i] = (int) cand[i].city;
+
+    free( cand );
+    free( q.heap_d );
+    free( q.heap_c );
+    free( q.found );
+}
+
+static void sorted_nn_list( long int node )
+/*    
+      FUNCTION: computes the candidate list of one city by sorting all distances
+      INPUT:    city index
+      OUTPUT:   none
+      (SIDE)EFFECTS: row node of nn_lists is set
+ */
+{
+    long int i;
     long int *distance_vector;
     long int *help_vector;
-    long int **m_nnear;
+
+    distance_vector = (long int *) calloc(instance.n, sizeof(long int));
+    help_vector = (long int *) calloc(instance.n, sizeof(long int));
+    if ( distance_vector == NULL || help_vector == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < instance.n ; i++ ) {  /* Copy distances from nodes to the others */
+        distance_vector[i] = instance_distance(node, i);
+        help_vector[i] = i;
+    }
+    distance_vector[node] = LONG_MAX;  /* city is not nearest neighbour */
+    sort2(distance_vector, help_vector, 0, instance.n - 1);
+    for ( i = 0 ; i < nn_depth ; i++ ) {
+        nn_lists[node][i] = help_vector[i];
+    }
+    free(distance_vector);
+    free(help_vector);
+}
+
+int** compute_nn_lists( void )
+/*    
+      FUNCTION: computes nearest neighbor lists of depth nn for each city
+      INPUT:    none
+      OUTPUT:   pointer to the nearest neighbor lists
+      COMMENTS: the lists of the cities are computed in parallel; a k-d tree is used 
+                if kd_tree_flag is set, unless the distances are geographical
+ */
+{
+    long int i, nn;
+    int      **m_nnear;
 
     TRACE ( printf("\n computing nearest neighbor lists, "); )
 
@@ -239,37 +777,258 @@ long int** compute_nn_lists( void )
 
     TRACE ( printf("nn = %ld ... \n",nn); )
 
-    if((m_nnear = (long int **) malloc(sizeof(long int) * instance.n * nn + instance.n * sizeof(long int *))) == NULL){
+    if((m_nnear = (int **) malloc(sizeof(int) * instance.n * nn + instance.n * sizeof(int *))) == NULL){
         exit(EXIT_FAILURE);
     }
-    distance_vector = (long int *) calloc(instance.n, sizeof(long int));
-    help_vector = (long int *) calloc(instance.n, sizeof(long int));
-
-    for ( node = 0 ; node < instance.n ; node++ ) {  /* compute cnd-sets for all node */
-        m_nnear[node] = (long int *)(m_nnear + instance.n) + node * nn;
+    for ( i = 0 ; i < instance.n ; i++ )
+        m_nnear[i] = (int *)(m_nnear + instance.n) + i * nn;
+    nn_lists = m_nnear;
+    nn_depth = nn;
+    instance.n_near = nn;
 
-        for ( i = 0 ; i < instance.n ; i++ ) {  /* Copy distances from nodes to the others */
-            distance_vector[i] = instance.distance[node][i];
-            help_vector[i] = i;
-        }
-        distance_vector[node] = LONG_MAX;  /* city is not nearest neighbour */
-        sort2(distance_vector, help_vector, 0, instance.n - 1);
-        for ( i = 0 ; i < nn ; i++ ) {
-            m_nnear[node][i] = help_vector[i];
+    if ( !kd_tree_flag || distance == geo_distance || instance.n < 4 ) {
+        parallel_for( instance.n, sorted_nn_list );
+    } else {
+        kd_city = (long int *) malloc( (instance.n - 1) * sizeof(long int) );
+        kd_dim = (char *) malloc( (instance.n - 1) * sizeof(char) );
+        if ( kd_city == NULL || kd_dim == NULL ) {
+            fprintf(stderr,"Out of memory, exit.");
+            exit(1);
         }
+        for ( i = 0 ; i < instance.n - 1 ; i++ )
+            kd_city[i] = i;
+        kd_build( 0, instance.n - 1 );
+        parallel_for( instance.n, kd_nn_list );
+        free( kd_city );
+        free( kd_dim );
+        kd_city = NULL;
+        kd_dim = NULL;
     }
-    free(distance_vector);
-    free(help_vector);
+    nn_lists = NULL;
     TRACE ( printf("\n    .. done\n"); )
 
     return m_nnear;
 }
 
-long int compute_fitness( long int *t, char *visited, long int t_size, char *p ) 
+static long int try_to_pack( int *t, long int pos, long int weight, long int *city_weight, 
+                             long int *weight_at, double *time_at, long int *next_active, double *time_buffer ) 
+/*    
+      FUNCTION: check whether picking up "weight" more at tour position pos keeps the 
+                travel time within instance.max_time and, if so, add it to the route
+      INPUT:    pointer to tour t, tour position pos, weight to be picked up and the 
+                current state of the route (weight picked up at each tour position, 
+                weight carried and arrival time at each active position, successor of 
+                each active position)
+      OUTPUT:   TRUE if the weight could be added, FALSE otherwise
+      COMMENTS: a tour position is active if some weight is picked up there; the depot 
+                (position 0) and the final city are always active. Only the segments 
+                after pos are re-timed, and the walk stops as soon as max_time is exceeded
+ */
+{
+    const double v = ( instance.max_speed - instance.min_speed ) / instance.capacity_of_knapsack;
+    long int prev = 0, curr, q, carried;
+    double _total_time;
+
+    if ( city_weight[pos] > 0 || next_active[pos] < 0 ) {
+        /* already active, the arrival time at pos does not change */
+        _total_time = time_at[pos];
+        carried = weight_at[pos] + weight;
+        q = next_active[pos];
+    }
+    else {
+        for ( prev = pos - 1 ; city_weight[prev] == 0 && prev > 0 ; prev-- ) ;
+        _total_time = time_at[prev] + instance_distance(t[prev], t[pos]) / ( instance.max_speed - v * weight_at[prev] );
+        if ( _total_time - EPSILON > instance.max_time ) return FALSE;
+        time_buffer[pos] = _total_time;
+        carried = weight_at[prev] + weight;
+        q = next_active[prev];
+    }
+
+    curr = pos;
+    while ( q >= 0 ) {
+        _total_time += instance_distance(t[curr], t[q]) / ( instance.max_speed - v * carried );
+        if ( _total_time - EPSILON > instance.max_time ) return FALSE;
+        time_buffer[q] = _total_time;
+        carried = weight_at[q] + weight;
+        curr = q;
+        q = next_active[q];
+    }
+
+    /* feasible, commit the new state of the route */
+    if ( city_weight[pos] == 0 && next_active[pos] >= 0 ) {
+        next_active[pos] = next_active[prev];
+        next_active[prev] = pos;
+        weight_at[pos] = weight_at[prev];
+        time_at[pos] = time_buffer[pos];
+    }
+    city_weight[pos] += weight;
+    weight_at[pos] += weight;
+    for ( q = next_active[pos] ; q >= 0 ; q = next_active[q] ) {
+        time_at[q] = time_buffer[q];
+        weight_at[q] += weight;
+    }
+    return TRUE;
+}
+
+struct packing_workspace * allocate_packing_workspace( void )
+/*    
+      FUNCTION: allocate the scratch arrays used by compute_fitness
+      INPUT:    none
+      OUTPUT:   pointer to the workspace
+      COMMENTS: tour positions range up to instance.n, hence arrays indexed by position 
+                have instance.n + 1 entries
+ */
+{
+    struct packing_workspace *w;
+
+    if ((w = (struct packing_workspace *) workspace_malloc(sizeof(struct packing_workspace))) == NULL) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    w->distance_accumulated = (long int *) workspace_malloc(instance.n * sizeof(long int));
+    w->position             = (long int *) workspace_malloc(instance.n * sizeof(long int));
+    w->candidate            = (long int *) workspace_malloc(instance.m * sizeof(long int));
+    w->candidate_log_profit = (double *) workspace_malloc(instance.m * sizeof(double));
+    w->candidate_log_weight = (double *) workspace_malloc(instance.m * sizeof(double));
+    w->candidate_log_remaining = (double *) workspace_malloc(instance.m * sizeof(double));
+    w->item_vector          = (double *) workspace_malloc(instance.m * sizeof(double));
+    w->help_vector          = (double *) workspace_malloc(instance.m * sizeof(double));
+    w->sort_stack           = (long int *) workspace_malloc((instance.m + 2) * sizeof(long int));
+    w->city_weight          = (long int *) workspace_malloc((instance.n + 1) * sizeof(long int));
+    w->weight_at            = (long int *) workspace_malloc((instance.n + 1) * sizeof(long int));
+    w->next_active          = (long int *) workspace_malloc((instance.n + 1) * sizeof(long int));
+    w->time_at              = (double *) workspace_malloc((instance.n + 1) * sizeof(double));
+    w->time_buffer          = (double *) workspace_malloc((instance.n + 1) * sizeof(double));
+    w->tmp_packing_plan     = (char *) workspace_malloc(instance.m * sizeof(char));
+
+    if ( w->distance_accumulated == NULL || w->position == NULL || 
+         w->candidate == NULL || w->candidate_log_profit == NULL || w->candidate_log_weight == NULL || 
+         w->candidate_log_remaining == NULL || w->item_vector == NULL || 
+         w->help_vector == NULL || w->sort_stack == NULL || w->city_weight == NULL || w->weight_at == NULL || 
+         w->next_active == NULL || w->time_at == NULL || w->time_buffer == NULL || 
+         w->tmp_packing_plan == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    return w;
+}
+
+void free_packing_workspace( struct packing_workspace *w )
+/*    
+      FUNCTION: free the scratch arrays used by compute_fitness
+      INPUT:    pointer to the workspace
+      OUTPUT:   none
+ */
+{
+    free(w->distance_accumulated);
+    free(w->position);
+    free(w->candidate);
+    free(w->candidate_log_profit);
+    free(w->candidate_log_weight);
+    free(w->candidate_log_remaining);
+    free(w->item_vector);
+    free(w->help_vector);
+    free(w->sort_stack);
+    free(w->city_weight);
+    free(w->weight_at);
+    free(w->next_active);
+    free(w->time_at);
+    free(w->time_buffer);
+    free(w->tmp_packing_plan);
+    free(w);
+}
+
+static unsigned long long tour_hash( int *t, long int t_size )
+/*    
+      FUNCTION: compute a 64-bit hash of the sequence of cities of tour t
+      INPUT:    pointer to tour t and its size
+      OUTPUT:   hash of the tour
+      COMMENTS: Zobrist hashing, each pair (position, city) is mapped to a pseudo-random 
+                key by the splitmix64 finalizer and the keys are combined with xor
+ */
+{
+    unsigned long long h = (unsigned long long) t_size, x;
+    long int i;
+
+    for ( i = 1 ; i < t_size - 3 ; i++ ) {
+        x = ((unsigned long long) t[i] << 32) ^ (unsigned long long) i;
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        h ^= x;
+    }
+    return h ? h : 1;
+}
+
+void allocate_packing_cache( void )
+/*    
+      FUNCTION: allocate the cache of packing plans
+      INPUT:    none
+      OUTPUT:   none
+      COMMENTS: the cache is direct-mapped; its size is rounded up to a power of two
+ */
+{
+    long int i, size;
+
+    if ( packing_cache_size <= 0 ) return;
+    for ( size = 1 ; size < packing_cache_size ; size *= 2 ) ;
+    packing_cache_size = size;
+    plan_words = ( instance.m + 63 ) / 64;
+
+    if ((packing_cache = (struct packing_cache_entry *) malloc(packing_cache_size * sizeof(struct packing_cache_entry))) == NULL) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+    for ( i = 0 ; i < packing_cache_size ; i++ ) {
+        if ((packing_cache[i].plan = (unsigned long long *) malloc(plan_words * sizeof(unsigned long long))) == NULL) {
+            printf("Out of memory, exit.");
+            exit(1);
+        }
+    }
+    clear_packing_cache();
+}
+
+void clear_packing_cache( void )
+/*    
+      FUNCTION: remove all entries of the cache of packing plans and reset its statistics
+      INPUT:    none
+      OUTPUT:   none
+ */
+{
+    long int i;
+
+    for ( i = 0 ; i < packing_cache_size ; i++ ) {
+        packing_cache[i].key = 0;
+    }
+    packing_cache_hits = packing_cache_misses = 0;
+}
+
+void free_packing_cache( void )
+/*    
+      FUNCTION: free the cache of packing plans
+      INPUT:    none
+      OUTPUT:   none
+ */
+{
+    long int i;
+
+    if ( packing_cache == NULL ) return;
+    for ( i = 0 ; i < packing_cache_size ; i++ ) {
+        free(packing_cache[i].plan);
+    }
+    free(packing_cache);
+    packing_cache = NULL;
+}
+
+long int compute_fitness( int *t, long int t_size, char *p, struct packing_workspace *w ) 
 /*    
       FUNCTION: compute the fitness of the ThOP solution generated from tour t
-      INPUT:    pointer to tour t and pointer to packing plan p
+      INPUT:    pointer to tour t, pointer to packing plan p and pointer to the 
+                workspace w that holds the scratch arrays
       OUTPUT:   fitness of the ThOP solution generated from tour t
+      COMMENTS: if the packing cache is enabled and tour t is found in it, the cached 
+                packing plan is returned without running the packing heuristic; the 
+                cache is shared by all threads and guarded by a mutex
  */
 {
 
@@ -281,99 +1040,162 @@ long int compute_fitness( long int *t, char *visited, long int t_size, char *p )
         printf("error: compute_fitness\n"); exit(0);
     } 
     
-    double par_a, par_b, par_c, par_sum;
-    long int prev_city, curr_city;
-    double _total_time;
-    long int _total_weight, total_weight, total_profit;    
-    int violate_max_time;
+    double par[3], par_a, par_b, par_c, par_sum;
+    long int total_weight, total_profit;    
+    unsigned long long key = 0;
+    struct packing_cache_entry *entry = NULL;
+
+    if ( packing_cache != NULL ) {
+        key = tour_hash( t, t_size );
+        entry = &packing_cache[key & (packing_cache_size - 1)];
+        pthread_mutex_lock( &packing_cache_mutex );
+        if ( entry->key == key && entry->tour_size == t_size ) {
+            packing_cache_hits++;
+            for ( j = 0 ; j < instance.m ; j++ ) {
+                p[j] = (entry->plan[j >> 6] >> (j & 63)) & 1;
+            }
+            total_profit = entry->fitness;
+            pthread_mutex_unlock( &packing_cache_mutex );
+            return total_profit;
+        }
+        packing_cache_misses++;
+        pthread_mutex_unlock( &packing_cache_mutex );
+    }
     
-    const double v = ( instance.max_speed - instance.min_speed ) / instance.capacity_of_knapsack;
+    long int last = t_size - 3;  /* tour position of the final city n-2 */
     
-    long int *distance_accumulated = (long int *) malloc ( instance.n * sizeof(long int));
+    long int *distance_accumulated = w->distance_accumulated;
+    long int *position = w->position;
+    long int *candidate = w->candidate;
+    double *candidate_log_profit = w->candidate_log_profit;
+    double *candidate_log_weight = w->candidate_log_weight;
+    double *candidate_log_remaining = w->candidate_log_remaining;
+    long int n_candidates, c, min_weight;
+    long int *sort_stack = w->sort_stack;
+    long int top = 0, sorted, chunk = 32;
+    double log_remaining;
 
     long int total_distance = 0;
 
     for ( i = 0 ; i < t_size-1 ; i++ ) {
         distance_accumulated[t[i]] = total_distance;
-        total_distance += instance.distance[t[i]][t[i+1]];        
+        total_distance += instance_distance(t[i], t[i+1]);        
+    }
+    for ( i = 0 ; i <= last ; i++ ) {
+        position[t[i]] = i;
     }
 
-    double *item_vector = (double *) malloc(instance.m * sizeof(double));
-    double *help_vector = (double *) malloc(instance.m * sizeof(double));
+    /* gather the data of the items placed in cities of the tour in contiguous arrays */
+    n_candidates = 0;
+    min_weight = LONG_MAX;
+    for ( i = 1 ; i <= last ; i++ ) {
+        c = t[i];
+        if ( instance.city_item_start[c] == instance.city_item_start[c + 1] ) continue;
+        log_remaining = log((double) (distance_accumulated[instance.n - 2] - distance_accumulated[c]));
+        for ( k = instance.city_item_start[c] ; k < instance.city_item_start[c + 1] ; k++ ) {
+            j = instance.city_items[k];
+            candidate[n_candidates] = j;
+            candidate_log_profit[n_candidates] = instance.log_profit[j];
+            candidate_log_weight[n_candidates] = instance.log_weight[j];
+            candidate_log_remaining[n_candidates] = log_remaining;
+            n_candidates++;
+            if ( instance.itemptr[j].weight < min_weight ) min_weight = instance.itemptr[j].weight;
+        }
+    }
+
+    double *item_vector = w->item_vector;
+    double *help_vector = w->help_vector;
     
-    long int *profit_accumulated = (long int *) malloc( instance.n * sizeof(long int));
-    long int *weight_accumulated = (long int *) malloc( instance.n * sizeof(long int));
+    long int *city_weight = w->city_weight;
+    long int *weight_at = w->weight_at;
+    long int *next_active = w->next_active;
+    double *time_at = w->time_at;
+    double *time_buffer = w->time_buffer;
     
     long int best_packing_plan_profit = 0;
-    char *tmp_packing_plan = (char *) malloc(instance.m * sizeof(char));
+    char *tmp_packing_plan = w->tmp_packing_plan;
+    
+    for ( j = 0 ; j < instance.m ; j++ ) {
+        tmp_packing_plan[j] = 0;
+    }
     
     long int _try;
         
     for( _try = 0; _try < max_packing_tries; _try++) {
         
-        for ( i = 0 ; i < instance.n ; i++ ) {
-            profit_accumulated[i] = weight_accumulated[i] = 0;
+        /* empty route: only the depot and the final city are active */
+        for ( i = 0 ; i <= last ; i++ ) {
+            city_weight[i] = 0;
+            next_active[i] = 0;
         }
+        weight_at[0] = weight_at[last] = 0;
+        next_active[0] = last; next_active[last] = -1;
+        time_at[0] = 0;
+        time_at[last] = instance_distance(t[0], t[last]) / instance.max_speed;
         
-        par_a = ran01( &seed );  /* uniform random number between [0.0, 1.0] */
-        par_b = ran01( &seed );  /* uniform random number between [0.0, 1.0] */
-        par_c = ran01( &seed );  /* uniform random number between [0.0, 1.0] */
+        rng_fill_ran01( &rng, par, 3 );  /* uniform random numbers between (0.0, 1.0) */
+        par_a = par[0]; par_b = par[1]; par_c = par[2];
 
         par_sum = (par_a + par_b + par_c); 
         par_a /= par_sum; par_b /= par_sum; par_c /= par_sum;
                 
-        l = 0;
+        for ( k = 0 ; k < n_candidates ; k++ ) {
+            tmp_packing_plan[candidate[k]] = 0;
+        }
 
-        for ( j = 0 ; j < instance.m ; j++ ) {
-            tmp_packing_plan[j] = 0;
-            if (visited[instance.itemptr[j].id_city] == FALSE) continue;
-            item_vector[l] = ( 
-                                -1.0 * pow(instance.itemptr[j].profit, par_a)
-                            ) 
-                            / 
-                            ( 
-                                pow(instance.itemptr[j].weight, par_b) * pow((distance_accumulated[instance.n - 2] - distance_accumulated[instance.itemptr[j].id_city]), par_c)
-                            );
-            help_vector[l] = j;
-            l++;
+        /* items are ranked by profit^a / (weight^b * remaining_distance^c); the score is 
+           the negated logarithm of this ratio, so that sorting it in ascending order gives 
+           the same ranking without any call to pow */
+        l = n_candidates;
+        for ( k = 0 ; k < l ; k++ ) {
+            item_vector[k] = par_b * candidate_log_weight[k] + par_c * candidate_log_remaining[k] - par_a * candidate_log_profit[k];
+        }
+        for ( k = 0 ; k < l ; k++ ) {
+            help_vector[k] = candidate[k];
         }
 
-        sort2_double(item_vector, help_vector, 0, l-1);
+        if ( time_at[last] - EPSILON > instance.max_time ) {
+            l = 0;  /* not even the empty route is feasible */
+        }
+
+        if ( partial_sort_flag ) {
+            /* items are sorted lazily in chunks of growing size, as the greedy 
+               packing below usually stops long before reaching the last items */
+            top = 0;
+            if ( l > 1 ) {
+                sort_stack[top++] = 0;
+                sort_stack[top++] = l - 1;
+            }
+            sorted = top > 0 ? 0 : l;
+            chunk = 32;
+        }
+        else {
+            sort2_double(item_vector, help_vector, 0, l-1);
+            sorted = l;
+        }
 
         total_weight = 0, total_profit = 0;            
         
         for ( k = 0 ; k < l ; k++ ) {
 
+            if ( instance.capacity_of_knapsack - total_weight < min_weight ) break;  /* no item fits anymore */
+
+            if ( k >= sorted ) {
+                top = partial_sort2_double(item_vector, help_vector, sort_stack, top, k + chunk - 1);
+                sorted = top > 0 ? sort_stack[top-2] : l;
+                chunk *= 2;
+            }
+
             j = help_vector[k];
                         
             if ( total_weight + instance.itemptr[j].weight > instance.capacity_of_knapsack ) continue;
 
-            profit_accumulated[instance.itemptr[j].id_city] += instance.itemptr[j].profit;
-            weight_accumulated[instance.itemptr[j].id_city] += instance.itemptr[j].weight; 
-            
-            violate_max_time = FALSE;
-            _total_time = _total_weight = 0;
-            prev_city = 0;
-            for ( i = 1 ; i < t_size; i++ ) {
-                curr_city = t[i];
-                if ( weight_accumulated[curr_city] == 0 && curr_city != instance.n - 2) continue;
-                _total_time += instance.distance[prev_city][curr_city] / ( instance.max_speed - v * _total_weight );    
-                if ( _total_time - EPSILON > instance.max_time ) {
-                    violate_max_time = TRUE; break;
-                }                
-                _total_weight += weight_accumulated[curr_city];
-                prev_city = curr_city;
-            }
-
-            if ( violate_max_time == FALSE) {
+            if ( try_to_pack( t, position[instance.itemptr[j].id_city], instance.itemptr[j].weight, 
+                              city_weight, weight_at, time_at, next_active, time_buffer ) ) {
                 total_profit += instance.itemptr[j].profit;     
                 total_weight += instance.itemptr[j].weight;
                 tmp_packing_plan[j] = 1;
             }
-            else {
-                profit_accumulated[instance.itemptr[j].id_city] -= instance.itemptr[j].profit;
-                weight_accumulated[instance.itemptr[j].id_city] -= instance.itemptr[j].weight; 
-            }
         }
         
         if ( total_profit > best_packing_plan_profit) {
@@ -384,12 +1206,19 @@ long int compute_fitness( long int *t, char *visited, long int t_size, char *p )
         }
     }
     
-    free(distance_accumulated);
-    free(item_vector);
-    free(help_vector);
-    free(profit_accumulated);
-    free(weight_accumulated);
-    free(tmp_packing_plan);
+    if ( entry != NULL ) {
+        pthread_mutex_lock( &packing_cache_mutex );
+        entry->key = key;
+        entry->tour_size = t_size;
+        entry->fitness = instance.UB + 1 - best_packing_plan_profit;
+        for ( j = 0 ; j < plan_words ; j++ ) {
+            entry->plan[j] = 0;
+        }
+        for ( j = 0 ; j < instance.m ; j++ ) {
+            if ( p[j] ) entry->plan[j >> 6] |= 1ULL << (j & 63);
+        }
+        pthread_mutex_unlock( &packing_cache_mutex );
+    }
 
     return instance.UB + 1 - best_packing_plan_profit;
 }
@@ -55,6 +55,9 @@
 
 
 #define RRR            6378.388
+
+#define MATRIX_FREE_MIN_CITIES 10000  /* by default, distances of larger instances are computed on demand */
+#define DISTANCE_CACHE_ROWS    16     /* no. of distance rows cached per thread without distance matrix */
 #ifndef PI             /* as in stroustrup */
 #define PI             3.14159265358979323846
 #endif
@@ -83,13 +86,43 @@ struct problem {
     long int      n_near;                 /* number of nearest neighbors */
     struct point  *nodeptr;               /* array of structs containing coordinates of nodes */
     struct item   *itemptr;               /* array of structs containing item data */
-    long int      **distance;             /* distance matrix: distance[i][j] gives distance between city i und j */
-    long int      **nn_list;              /* nearest neighbor list; contains for each node i a sorted list of n_near nearest neighbors */
+    long int      **distance;             /* distance matrix: distance[i][j] gives distance between city i und j, NULL if computed on demand */
+    int           **compact_distance;     /* distance matrix with 32 bit entries, NULL if not used */
+    int           **nn_list;              /* nearest neighbor list; contains for each node i a sorted list of n_near nearest neighbors */
     long int      UB;                     /* objective value of the optimal solution of the fractional knapsack problem */
+    double        *log_profit;            /* log_profit[j] is the natural logarithm of the profit of item j */
+    double        *log_weight;            /* log_weight[j] is the natural logarithm of the weight of item j */
+    long int      *city_item_start;       /* the items of city i are city_items[city_item_start[i]] ... city_items[city_item_start[i+1]-1] */
+    long int      *city_items;            /* item indices grouped by city, in increasing order within each city */
 };
 
 extern struct problem instance;
 
+struct packing_workspace {
+    long int      *distance_accumulated;  /* distance travelled from the depot up to each city */
+    long int      *position;              /* position of each city in the tour */
+    long int      *candidate;             /* items placed in cities of the tour */
+    double        *candidate_log_profit;  /* logarithm of the profit of each candidate item */
+    double        *candidate_log_weight;  /* logarithm of the weight of each candidate item */
+    double        *candidate_log_remaining; /* logarithm of the distance from each candidate item to the end of the tour */
+    double        *item_vector;           /* score of each candidate item */
+    double        *help_vector;           /* index of each candidate item */
+    long int      *sort_stack;            /* ranges of item_vector that are not sorted yet */
+    long int      *city_weight;           /* weight picked up at each tour position */
+    long int      *weight_at;             /* weight carried when leaving each active tour position */
+    long int      *next_active;           /* next active tour position */
+    double        *time_at;               /* arrival time at each active tour position */
+    double        *time_buffer;           /* tentative arrival times while checking an item */
+    char          *tmp_packing_plan;      /* packing plan of the current try */
+};
+
+extern __thread struct packing_workspace *packing_ws;  /* workspace used by compute_fitness, one per thread */
+
+
+extern long int packing_cache_size;           /* number of entries of the packing cache, 0 disables it */
+extern long int packing_cache_hits;           /* number of tours whose packing plan was found in the cache */
+extern long int packing_cache_misses;         /* number of tours whose packing plan had to be computed */
+
 extern long int (*distance)(long int, long int);  
 
 long int round_distance(long int i, long int j);
@@ -102,8 +135,48 @@ long int att_distance(long int i, long int j);
 
 long int** compute_distances(void);
 
-long int** compute_nn_lists(void);
+extern long int compact_flag;      /* = 1, store distances in 32 bits if they fit */
+
+extern long int kd_tree_flag;      /* = 1, build the candidate lists with a k-d tree */
+
+int** compute_compact_distances(void);
+
+extern long int matrix_free_flag;  /* = 1, no distance matrix, distances are computed on demand, -1: decide by size */
+
+void init_distance_on_demand(void);
+
+long int distance_on_demand(long int i, long int j);
+
+const long int * distance_row(long int i);
+
+void free_distance_cache(void);
+
+static inline long int instance_distance( long int i, long int j )
+/*    
+      FUNCTION: distance between two cities, from the matrix if there is one
+      INPUT:    two city indices
+      OUTPUT:   their distance
+ */
+{
+    if ( instance.compact_distance != NULL )
+        return instance.compact_distance[i][j];
+    if ( instance.distance != NULL )
+        return instance.distance[i][j];
+    return distance_on_demand( i, j );
+}
+
+int** compute_nn_lists(void);
+
+struct packing_workspace * allocate_packing_workspace(void);
+
+void free_packing_workspace(struct packing_workspace *w);
+
+void allocate_packing_cache(void);
+
+void clear_packing_cache(void);
+
+void free_packing_cache(void);
 
-long int compute_fitness(long int *t, char *visited, long int t_size, char *p);
+long int compute_fitness(int *t, long int t_size, char *p, struct packing_workspace *w);
 
 #endif
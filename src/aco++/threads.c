@@ -0,0 +1,221 @@
+/*
+
+       AAAA    CCCC   OOOO   TTTTTT   SSSSS  PPPPP
+      AA  AA  CC     OO  OO    TT    SS      PP  PP
+      AAAAAA  CC     OO  OO    TT     SSSS   PPPPP
+      AA  AA  CC     OO  OO    TT        SS  PP
+      AA  AA   CCCC   OOOO     TT    SSSSS   PP
+
+######################################################
+##########    ACO algorithms for the TSP    ##########
+######################################################
+
+      Version: 1.0
+      File:    threads.c
+      Purpose: pool of threads that processes the ants in parallel
+      Check:   README and gpl.txt
+ */
+
+/***************************************************************************
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "inout.h"
+#include "thop.h"
+#include "ants.h"
+#include "ls.h"
+#include "utilities.h"
+#include "threads.h"
+
+long int n_threads = 1;   /* number of threads, including the main one */
+
+static pthread_t       *workers;
+static double          **worker_prob_of_selection;
+static struct packing_workspace **worker_packing_ws;
+static struct ls_workspace **worker_ls_ws;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work_available = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  work_done = PTHREAD_COND_INITIALIZER;
+
+static void            (*pool_task)(long int);   /* task run for each index */
+static long int        pool_n_tasks;             /* number of indices of the current job */
+static long int        pool_next_task;           /* next index to be taken by some thread */
+static long int        pool_generation = 0;      /* incremented whenever a new job is posted */
+static long int        pool_busy_workers;        /* workers still running the current job */
+static long int        pool_shutdown = FALSE;
+
+static void run_tasks( void )
+/*    
+      FUNCTION:       run tasks of the current job until all indices are taken
+      INPUT:          none
+      OUTPUT:         none
+      COMMENTS:       indices are handed out one at a time through an atomic counter, so 
+                      threads that get cheap tasks take more of them
+ */
+{
+    long int k;
+
+    while ( (k = __sync_fetch_and_add( &pool_next_task, 1 )) < pool_n_tasks ) {
+        pool_task( k );
+    }
+}
+
+static void * worker( void *arg )
+/*    
+      FUNCTION:       main loop of a worker thread
+      INPUT:          index of the worker thread
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the thread-local selection probabilities, packing and local search 
+                      workspaces are set to the ones reserved for this thread
+ */
+{
+    long int id = (long int) arg;
+    long int generation = 0;
+
+    prob_of_selection = worker_prob_of_selection[id];
+    packing_ws = worker_packing_ws[id];
+    ls_ws = worker_ls_ws[id];
+
+    pthread_mutex_lock( &pool_mutex );
+    for ( ; ; ) {
+        while ( generation == pool_generation && !pool_shutdown )
+            pthread_cond_wait( &work_available, &pool_mutex );
+        if ( pool_shutdown )
+            break;
+        generation = pool_generation;
+        pthread_mutex_unlock( &pool_mutex );
+        run_tasks();
+        pthread_mutex_lock( &pool_mutex );
+        if ( --pool_busy_workers == 0 )
+            pthread_cond_signal( &work_done );
+    }
+    pthread_mutex_unlock( &pool_mutex );
+    free_distance_cache();
+    return NULL;
+}
+
+void start_thread_pool( void )
+/*    
+      FUNCTION:       start n_threads - 1 worker threads; the main thread is the remaining one
+      INPUT:          none
+      OUTPUT:         none
+      (SIDE)EFFECTS:  per-thread selection probabilities, packing and local search workspaces 
+                      are allocated
+      COMMENTS:       the tasks set their own random number streams, see rng_init_stream. 
+                      All workspaces are allocated here, so that no thread allocates memory 
+                      once the iterations have started
+ */
+{
+    long int i;
+
+    if ( n_threads <= 1 ) return;
+
+    workers = (pthread_t *) malloc( n_threads * sizeof(pthread_t) );
+    worker_prob_of_selection = (double **) malloc( n_threads * sizeof(double *) );
+    worker_packing_ws = (struct packing_workspace **) malloc( n_threads * sizeof(struct packing_workspace *) );
+    worker_ls_ws = (struct ls_workspace **) malloc( n_threads * sizeof(struct ls_workspace *) );
+    if ( workers == NULL || worker_prob_of_selection == NULL || worker_packing_ws == NULL || 
+         worker_ls_ws == NULL ) {
+        printf("Out of memory, exit.");
+        exit(1);
+    }
+
+    for ( i = 1 ; i < n_threads ; i++ ) {
+        if ((worker_prob_of_selection[i] = (double *) malloc(sizeof(double) * (nn_ants + 1))) == NULL) {
+            printf("Out of memory, exit.");
+            exit(1);
+        }
+        worker_packing_ws[i] = allocate_packing_workspace();
+        worker_ls_ws[i] = ls_flag ? allocate_ls_workspace() : NULL;
+    }
+
+    for ( i = 1 ; i < n_threads ; i++ ) {
+        if ( pthread_create( &workers[i], NULL, worker, (void *) i ) != 0 ) {
+            fprintf(stderr, "error: could not create thread %ld\n", i);
+            exit(1);
+        }
+    }
+}
+
+void stop_thread_pool( void )
+/*    
+      FUNCTION:       stop the worker threads and free their data
+      INPUT:          none
+      OUTPUT:         none
+ */
+{
+    long int i;
+
+    if ( n_threads <= 1 ) return;
+
+    pthread_mutex_lock( &pool_mutex );
+    pool_shutdown = TRUE;
+    pthread_cond_broadcast( &work_available );
+    pthread_mutex_unlock( &pool_mutex );
+
+    for ( i = 1 ; i < n_threads ; i++ ) {
+        pthread_join( workers[i], NULL );
+        free( worker_prob_of_selection[i] );
+        free_packing_workspace( worker_packing_ws[i] );
+        free_ls_workspace( worker_ls_ws[i] );
+    }
+    free( workers );
+    free( worker_prob_of_selection );
+    free( worker_packing_ws );
+    free( worker_ls_ws );
+}
+
+void parallel_for( long int n_tasks, void (*task)(long int) )
+/*    
+      FUNCTION:       run task(k) for k = 0, ..., n_tasks - 1 on all threads of the pool
+      INPUT:          number of tasks and task to be run
+      OUTPUT:         none
+      (SIDE)EFFECTS:  returns once all tasks are finished
+      COMMENTS:       the main thread takes part in the work; without worker threads the 
+                      tasks are run in order
+ */
+{
+    long int k;
+
+    if ( n_threads <= 1 ) {
+        for ( k = 0 ; k < n_tasks ; k++ ) 
+            task( k );
+        return;
+    }
+
+    pthread_mutex_lock( &pool_mutex );
+    pool_task = task;
+    pool_n_tasks = n_tasks;
+    pool_next_task = 0;
+    pool_busy_workers = n_threads - 1;
+    pool_generation++;
+    pthread_cond_broadcast( &work_available );
+    pthread_mutex_unlock( &pool_mutex );
+
+    run_tasks();
+
+    pthread_mutex_lock( &pool_mutex );
+    while ( pool_busy_workers > 0 )
+        pthread_cond_wait( &work_done, &pool_mutex );
+    pthread_mutex_unlock( &pool_mutex );
+}
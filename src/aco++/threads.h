@@ -0,0 +1,50 @@
+/*
+
+       AAAA    CCCC   OOOO   TTTTTT   SSSSS  PPPPP
+      AA  AA  CC     OO  OO    TT    SS      PP  PP
+      AAAAAA  CC     OO  OO    TT     SSSS   PPPPP
+      AA  AA  CC     OO  OO    TT        SS  PP
+      AA  AA   CCCC   OOOO     TT    SSSSS   PP
+
+######################################################
+##########    ACO algorithms for the TSP    ##########
+######################################################
+
+      Version: 1.0
+      File:    threads.h
+      Purpose: header file for the pool of threads that processes the ants in parallel
+      Check:   README and gpl.txt
+ */
+
+/***************************************************************************
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***************************************************************************/
+
+#ifndef _THREADS_H_
+#define _THREADS_H_
+
+#define MAX_THREADS    256     /* max no. of threads */
+
+extern long int n_threads;     /* number of threads, including the main one */
+
+void start_thread_pool ( void );
+
+void stop_thread_pool ( void );
+
+void parallel_for ( long int n_tasks, void (*task)(long int) );
+
+#endif
@@ -55,7 +55,11 @@
 
 typedef enum type_timer {REAL, VIRTUAL} TIMER_TYPE;
 
+extern TIMER_TYPE timer_type;  /* time used for the time limit and the statistics */
+
 void start_timers(void);
 double elapsed_time(TIMER_TYPE type);
 
+double thread_time(void);
+
 #endif
@@ -0,0 +1,365 @@
+/*
+
+       AAAA    CCCC   OOOO   TTTTTT   SSSSS  PPPPP
+      AA  AA  CC     OO  OO    TT    SS      PP  PP
+      AAAAAA  CC     OO  OO    TT     SSSS   PPPPP
+      AA  AA  CC     OO  OO    TT        SS  PP
+      AA  AA   CCCC   OOOO     TT    SSSSS   PP
+
+######################################################
+##########    ACO algorithms for the TSP    ##########
+######################################################
+
+      Version: 1.0
+      File:    twolevel.c
+      Purpose: two-level list representation of long tours for the local search
+      Check:   README and gpl.txt
+ */
+
+/***************************************************************************
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "utilities.h"
+#include "twolevel.h"
+
+#define SHORT_PART_FACTOR  3   /* parts of up to this many times the initial block size 
+                                  are rewritten city by city */
+
+void two_level_allocate( struct two_level_list *l, long int max_n )
+/*    
+      FUNCTION:       allocate a two-level list
+      INPUT:          pointer to the list and maximal number of cities (and largest city 
+                      index plus one) of its tours
+      OUTPUT:         none
+ */
+{
+    l->capacity   = 2 * (long int) sqrt( (double) max_n ) + 16;
+    l->n          = 0;
+    l->n_blocks   = 0;
+    l->max_blocks = l->capacity;
+    l->city       = (int *) workspace_malloc( max_n * sizeof(int) );
+    l->node       = (struct two_level_node *) workspace_malloc( max_n * sizeof(struct two_level_node) );
+    l->tour_help  = (int *) workspace_malloc( max_n * sizeof(int) );
+    l->slot_help  = (int *) workspace_malloc( max_n * sizeof(int) );
+    l->owner_help = (int *) workspace_malloc( max_n * sizeof(int) );
+    l->blocks     = (struct two_level_block *) workspace_malloc( l->capacity * sizeof(struct two_level_block) );
+    l->order      = (int *) workspace_malloc( l->capacity * sizeof(int) );
+    l->block_help = (int *) workspace_malloc( l->capacity * sizeof(int) );
+    if ( l->city == NULL || l->node == NULL || l->tour_help == NULL || l->slot_help == NULL ||
+         l->owner_help == NULL || l->blocks == NULL || l->order == NULL || l->block_help == NULL ) {
+        fprintf(stderr,"Out of memory, exit.");
+        exit(1);
+    }
+}
+
+void two_level_free( struct two_level_list *l )
+/*    
+      FUNCTION:       free the arrays of a two-level list
+      INPUT:          pointer to the list
+      OUTPUT:         none
+ */
+{
+    free( l->city );
+    free( l->node );
+    free( l->tour_help );
+    free( l->slot_help );
+    free( l->owner_help );
+    free( l->blocks );
+    free( l->order );
+    free( l->block_help );
+}
+
+void two_level_build( struct two_level_list *l, const int *tour, long int n )
+/*    
+      FUNCTION:       set up the list for a tour
+      INPUT:          pointer to the list, tour and number n of its cities (without 
+                      the closing city)
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the tour is cut into blocks of about sqrt(n) cities
+ */
+{
+    long int i, b, size;
+
+    size = (long int) sqrt( (double) n );
+    if ( size < 1 )
+        size = 1;
+    l->n = n;
+    l->short_part = SHORT_PART_FACTOR * size;
+    l->n_blocks = (n + size - 1) / size;
+    l->max_blocks = 2 * l->n_blocks + 8;
+    if ( l->max_blocks > l->capacity )
+        l->max_blocks = l->capacity;
+    DEBUG ( assert( l->n_blocks + 3 <= l->max_blocks ); )
+    for ( i = 0 ; i < n ; i++ ) {
+        l->city[i] = tour[i];
+        l->node[tour[i]].slot = i;
+        l->node[tour[i]].block = i / size;
+    }
+    for ( b = 0 ; b < l->n_blocks ; b++ ) {
+        l->blocks[b].lo = b * size;
+        l->blocks[b].hi = b * size + size < n ? b * size + size : n;
+        l->blocks[b].reversed = FALSE;
+        l->blocks[b].start = b * size;
+        l->blocks[b].rank = b;
+        l->order[b] = b;
+    }
+}
+
+void two_level_to_tour( const struct two_level_list *l, int *tour )
+/*    
+      FUNCTION:       write the tour held by the list into an array
+      INPUT:          pointer to the list and array of (at least) l->n entries
+      OUTPUT:         none
+      (SIDE)EFFECTS:  every city is stored at its tour position; the closing city 
+                      is not set
+ */
+{
+    const struct two_level_block *b;
+    long int r, s, p;
+
+    for ( r = 0 ; r < l->n_blocks ; r++ ) {
+        b = &l->blocks[l->order[r]];
+        p = b->start;
+        if ( !b->reversed ) {
+            for ( s = b->lo ; s < b->hi ; s++ ) {
+                tour[p] = l->city[s];
+                if ( ++p == l->n )
+                    p = 0;
+            }
+        }
+        else {
+            for ( s = b->hi - 1 ; s >= b->lo ; s-- ) {
+                tour[p] = l->city[s];
+                if ( ++p == l->n )
+                    p = 0;
+            }
+        }
+    }
+}
+
+static void split_before( struct two_level_list *l, long int c )
+/*    
+      FUNCTION:       make city c the first city of its block
+      INPUT:          pointer to the list and a city
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the block of c is split in two; the smaller part gets a new 
+                      block number, so that fewer cities are relabelled
+ */
+{
+    struct two_level_block *b = &l->blocks[l->node[c].block], *e;
+    long int k, s, r, r_e, split, first_part;
+
+    k = b->reversed ? b->hi - 1 - l->node[c].slot : l->node[c].slot - b->lo;
+    if ( k == 0 )
+        return;
+    e = &l->blocks[l->n_blocks];
+    first_part = 2 * k < b->hi - b->lo;   /* = TRUE: e gets the cities before c */
+    /* the parts occupy the slots lo .. split-1 and split .. hi-1; the upper slots 
+       hold the cities before c if the block is reversed */
+    split = b->reversed ? l->node[c].slot + 1 : l->node[c].slot;
+    e->reversed = b->reversed;
+    if ( first_part == b->reversed ) {
+        e->lo = split;
+        e->hi = b->hi;
+        b->hi = split;
+    }
+    else {
+        e->lo = b->lo;
+        e->hi = split;
+        b->lo = split;
+    }
+    for ( s = e->lo ; s < e->hi ; s++ )
+        l->node[l->city[s]].block = l->n_blocks;
+    if ( first_part ) {
+        e->start = b->start;
+        b->start = b->start + k < l->n ? b->start + k : b->start + k - l->n;
+    }
+    else
+        e->start = b->start + k < l->n ? b->start + k : b->start + k - l->n;
+    /* the new block is inserted before (first_part) or after block b */
+    r_e = b->rank + 1 - first_part;
+    for ( r = l->n_blocks ; r > r_e ; r-- ) {
+        l->order[r] = l->order[r-1];
+        l->blocks[l->order[r]].rank = r;
+    }
+    l->order[r_e] = l->n_blocks;
+    e->rank = r_e;
+    l->n_blocks++;
+}
+
+static long int append_blocks( struct two_level_list *l, long int k, long int m, 
+                               long int reverse, long int i )
+/*    
+      FUNCTION:       append m consecutive blocks, starting at rank k, to block_help
+      INPUT:          pointer to the list, rank of the first block, number of blocks, 
+                      whether they are appended in reverse order, and number i of 
+                      blocks already in block_help
+      OUTPUT:         number of blocks in block_help
+      (SIDE)EFFECTS:  if reverse, the direction of the blocks is flipped
+ */
+{
+    long int t, r, b;
+
+    for ( t = 0 ; t < m ; t++ ) {
+        r = reverse ? k + m - 1 - t : k + t;
+        b = l->order[r % l->n_blocks];
+        if ( reverse )
+            l->blocks[b].reversed = !l->blocks[b].reversed;
+        l->block_help[i++] = b;
+    }
+    return i;
+}
+
+static long int put_cities( struct two_level_list *l, long int first, long int m, 
+                            long int reverse, long int t )
+/*    
+      FUNCTION:       put m cities of tour_help, starting at index first, into the slots 
+                      slot_help[t] .. slot_help[t+m-1]
+      INPUT:          pointer to the list, first index and number of the cities, whether 
+                      they are put in reverse order, and index t of the first slot
+      OUTPUT:         index of the next free slot
+ */
+{
+    long int i, c;
+
+    for ( i = 0 ; i < m ; i++, t++ ) {
+        c = l->tour_help[reverse ? first + m - 1 - i : first + i];
+        l->city[l->slot_help[t]] = c;
+        l->node[c].slot = l->slot_help[t];
+        l->node[c].block = l->owner_help[t];
+    }
+    return t;
+}
+
+static void rewrite_cities( struct two_level_list *l, long int a1, long int n_a, long int n_b,
+                            long int swap, long int reverse_a, long int reverse_b )
+/*    
+      FUNCTION:       rewrite a short part of the tour city by city
+      INPUT:          pointer to the list, first city a1 of the part, number of cities of 
+                      A and B, and the rewrite as in two_level_rearrange
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the cities change slots; the blocks are left unchanged
+ */
+{
+    long int t, c;
+
+    for ( t = 0, c = a1 ; t < n_a + n_b ; t++ ) {
+        l->tour_help[t]  = c;
+        l->slot_help[t]  = l->node[c].slot;
+        l->owner_help[t] = l->node[c].block;
+        c = two_level_succ( l, c );
+    }
+    if ( swap ) {
+        t = put_cities( l, n_a, n_b, reverse_b, 0 );
+        put_cities( l, 0, n_a, reverse_a, t );
+    }
+    else {
+        t = put_cities( l, 0, n_a, reverse_a, 0 );
+        put_cities( l, n_a, n_b, reverse_b, t );
+    }
+}
+
+void two_level_rearrange( struct two_level_list *l, long int a1, long int a2, long int b2,
+                          long int swap, long int reverse_a, long int reverse_b )
+/*    
+      FUNCTION:       rewrite two consecutive parts of the tour, A = a1 .. a2 and 
+                      B = successor of a2 .. b2, in place
+      INPUT:          pointer to the list, cities delimiting the parts (b2 < 0: B is 
+                      empty), whether B is put before A, and whether A and B are reversed
+      OUTPUT:         none
+      (SIDE)EFFECTS:  same result as copying the parts in the array representation 
+                      (segment insertion, 3-opt moves): the parts occupy the same tour 
+                      positions as before. O(sqrt(n)) time
+ */
+{
+    long int p, b1, e, nb, ka, kb, ke, n_a, n_b, i, t, b;
+
+    p   = two_level_pos( l, a1 );
+    n_a = two_level_pos( l, a2 ) - p + 1;
+    if ( n_a <= 0 )
+        n_a += l->n;
+    n_b = 0;
+    if ( b2 >= 0 ) {
+        n_b = two_level_pos( l, b2 ) - two_level_pos( l, a2 );
+        if ( n_b < 0 )
+            n_b += l->n;
+    }
+    if ( n_a + n_b <= l->short_part ) {
+        rewrite_cities( l, a1, n_a, n_b, swap, reverse_a, reverse_b );
+        return;
+    }
+
+    if ( l->n_blocks + 3 > l->max_blocks ) {
+        two_level_to_tour( l, l->tour_help );
+        two_level_build( l, l->tour_help, l->n );
+    }
+    b1 = b2 >= 0 ? two_level_succ( l, a2 ) : -1;
+    e  = two_level_succ( l, b2 >= 0 ? b2 : a2 );
+    split_before( l, a1 );
+    if ( b1 >= 0 )
+        split_before( l, b1 );
+    if ( e != a1 )
+        split_before( l, e );
+
+    nb = l->n_blocks;
+    ka = l->blocks[l->node[a1].block].rank;
+    ke = l->blocks[l->node[e].block].rank;
+    if ( b1 >= 0 ) {
+        kb  = l->blocks[l->node[b1].block].rank;
+        n_a = (kb - ka + nb) % nb;
+        n_b = (ke - kb + nb) % nb;
+    }
+    else {
+        kb  = ke;
+        n_a = e != a1 ? (ke - ka + nb) % nb : nb;
+        n_b = 0;
+    }
+    if ( swap ) {
+        i = append_blocks( l, kb, n_b, reverse_b, 0 );
+        i = append_blocks( l, ka, n_a, reverse_a, i );
+    }
+    else {
+        i = append_blocks( l, ka, n_a, reverse_a, 0 );
+        i = append_blocks( l, kb, n_b, reverse_b, i );
+    }
+    for ( t = 0 ; t < i ; t++ ) {
+        b = l->block_help[t];
+        l->order[(ka + t) % nb] = b;
+        l->blocks[b].rank = (ka + t) % nb;
+        l->blocks[b].start = p;
+        p += l->blocks[b].hi - l->blocks[b].lo;
+        if ( p >= l->n )
+            p -= l->n;
+    }
+}
+
+void two_level_reverse( struct two_level_list *l, long int a1, long int a2 )
+/*    
+      FUNCTION:       reverse the part a1 .. a2 of the tour
+      INPUT:          pointer to the list, first and last city of the part
+      OUTPUT:         none
+      (SIDE)EFFECTS:  same result as reversing the part in the array representation; 
+                      O(sqrt(n)) time
+ */
+{
+    two_level_rearrange( l, a1, a2, -1, FALSE, TRUE, FALSE );
+}
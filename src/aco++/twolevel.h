@@ -0,0 +1,146 @@
+/*
+
+       AAAA    CCCC   OOOO   TTTTTT   SSSSS  PPPPP
+      AA  AA  CC     OO  OO    TT    SS      PP  PP
+      AAAAAA  CC     OO  OO    TT     SSSS   PPPPP
+      AA  AA  CC     OO  OO    TT        SS  PP
+      AA  AA   CCCC   OOOO     TT    SSSSS   PP
+
+######################################################
+##########    ACO algorithms for the TSP    ##########
+######################################################
+
+      Version: 1.0
+      File:    twolevel.h
+      Purpose: header file for the two-level list representation of long tours
+      Check:   README and gpl.txt
+ */
+
+/***************************************************************************
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+ ***************************************************************************/
+
+#ifndef _TWOLEVEL_H_
+#define _TWOLEVEL_H_
+
+/* The tour is cut into about sqrt(n) blocks. A block holds a contiguous part of
+   the tour in the array city, may be traversed in reverse and knows the tour
+   position of its first city. Reversing or exchanging long parts of the tour splits
+   at most three blocks and then only reorders and flips whole blocks; short parts
+   are rewritten city by city in the slots they occupy. */
+
+struct two_level_block {
+    int      lo;             /* the block holds city[lo] .. city[hi-1] */
+    int      hi;
+    int      reversed;       /* = TRUE: the block is traversed from hi-1 down to lo */
+    int      start;          /* tour position of the first city of the block */
+    int      rank;           /* index of the block in order */
+};
+
+struct two_level_node {
+    int      slot;           /* index of the city in city */
+    int      block;          /* block that holds the city */
+};
+
+struct two_level_list {
+    long int n;              /* number of cities of the tour */
+    long int n_blocks;       /* current number of blocks */
+    long int max_blocks;     /* the blocks are rebuilt before they exceed this number */
+    long int capacity;       /* number of allocated blocks */
+    long int short_part;     /* parts of at most this many cities are rewritten city by city */
+    int      *city;          /* cities of the tour, grouped by blocks */
+    struct two_level_node  *node;    /* slot and block of each city */
+    struct two_level_block *blocks;
+    int      *order;         /* blocks in tour order */
+    int      *block_help;    /* help vectors for reordering blocks, rebuilding and */
+    int      *tour_help;     /* rewriting short parts */
+    int      *slot_help;
+    int      *owner_help;
+};
+
+void two_level_allocate( struct two_level_list *l, long int max_n );
+
+void two_level_free( struct two_level_list *l );
+
+void two_level_build( struct two_level_list *l, const int *tour, long int n );
+
+void two_level_to_tour( const struct two_level_list *l, int *tour );
+
+void two_level_reverse( struct two_level_list *l, long int a1, long int a2 );
+
+void two_level_rearrange( struct two_level_list *l, long int a1, long int a2, long int b2,
+                          long int swap, long int reverse_a, long int reverse_b );
+
+static inline long int two_level_pos( const struct two_level_list *l, long int c )
+/*
+      FUNCTION: tour position of a city
+      INPUT:    two-level list and a city of its tour
+      OUTPUT:   position of the city, as in the array representation of the tour
+ */
+{
+    const struct two_level_node  *v = &l->node[c];
+    const struct two_level_block *b = &l->blocks[v->block];
+    long int p = b->start + ( b->reversed ? b->hi - 1 - v->slot : v->slot - b->lo );
+
+    return p < l->n ? p : p - l->n;
+}
+
+static inline long int two_level_succ( const struct two_level_list *l, long int c )
+/*
+      FUNCTION: successor of a city in the tour
+      INPUT:    two-level list and a city of its tour
+      OUTPUT:   the city that follows it
+ */
+{
+    const struct two_level_node  *v = &l->node[c];
+    const struct two_level_block *b = &l->blocks[v->block];
+    long int r;
+
+    if ( !b->reversed ) {
+        if ( v->slot + 1 < b->hi )
+            return l->city[v->slot+1];
+    }
+    else if ( v->slot > b->lo )
+        return l->city[v->slot-1];
+    r = b->rank + 1;
+    b = &l->blocks[l->order[r < l->n_blocks ? r : 0]];
+    return b->reversed ? l->city[b->hi-1] : l->city[b->lo];
+}
+
+static inline long int two_level_pred( const struct two_level_list *l, long int c )
+/*
+      FUNCTION: predecessor of a city in the tour
+      INPUT:    two-level list and a city of its tour
+      OUTPUT:   the city that precedes it
+ */
+{
+    const struct two_level_node  *v = &l->node[c];
+    const struct two_level_block *b = &l->blocks[v->block];
+    long int r;
+
+    if ( !b->reversed ) {
+        if ( v->slot > b->lo )
+            return l->city[v->slot-1];
+    }
+    else if ( v->slot + 1 < b->hi )
+        return l->city[v->slot+1];
+    r = b->rank - 1;
+    b = &l->blocks[l->order[r >= 0 ? r : l->n_blocks - 1]];
+    return b->reversed ? l->city[b->lo] : l->city[b->hi-1];
+}
+
+#endif
@@ -20,13 +20,14 @@
 #include <stdio.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <time.h>
 
 #include "timer.h"
 
-static struct rusage res;
-static struct timeval tp;
 static double virtual_time, real_time;
 
+TIMER_TYPE timer_type = VIRTUAL;  /* time used for the time limit and the statistics */
+
 void start_timers(void)
 /*    
       FUNCTION:       virtual and real time of day are computed and stored to 
@@ -37,6 +38,9 @@ void start_timers(void)
       (SIDE)EFFECTS:  virtual and real time are computed   
  */
 {
+    struct rusage res;
+    struct timeval tp;
+
     getrusage( RUSAGE_SELF, &res );
     virtual_time = (double) res.ru_utime.tv_sec + (double) res.ru_stime.tv_sec + (double) res.ru_utime.tv_usec / 1000000.0 + (double) res.ru_stime.tv_usec / 1000000.0;
     gettimeofday( &tp, NULL );
@@ -49,8 +53,12 @@ double elapsed_time(TIMER_TYPE type)
       INPUT:          TIMER_TYPE (virtual or real time)
       OUTPUT:         seconds since last call to start_timers (virtual or real)
       (SIDE)EFFECTS:  none
+      COMMENTS:       may be called by several threads at the same time
  */
 {
+    struct rusage res;
+    struct timeval tp;
+
     if (type == REAL) {
         gettimeofday( &tp, NULL );
         return ( (double) tp.tv_sec + (double) tp.tv_usec / 1000000.0 - real_time );
@@ -59,4 +67,19 @@ double elapsed_time(TIMER_TYPE type)
         getrusage( RUSAGE_SELF, &res );
         return ( (double) res.ru_utime.tv_sec + (double) res.ru_stime.tv_sec + (double) res.ru_utime.tv_usec / 1000000.0 + (double) res.ru_stime.tv_usec / 1000000.0 - virtual_time );
     }
-}
\ No newline at end of file
+}
+
+double thread_time(void)
+/*    
+      FUNCTION:       return the CPU time used by the calling thread
+      INPUT:          none
+      OUTPUT:         seconds of CPU time used by the calling thread since it was started
+      (SIDE)EFFECTS:  none
+      COMMENTS:       only differences of two calls by the same thread are meaningful
+ */
+{
+    struct timespec tp;
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &tp );
+    return (double) tp.tv_sec + (double) tp.tv_nsec / 1000000000.0;
+}
@@ -54,6 +54,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include <string.h>
 
 #include "inout.h"
 #include "utilities.h"
@@ -61,6 +62,8 @@
 #include "ants.h"
 #include "timer.h"
 
+long int workspace_allocations = 0;
+
 double mean( long int *values, long int max ) 
 /*    
       FUNCTION:       compute the average value of an integer array of length max 
@@ -356,6 +359,69 @@ void sort2_double(double *v, double *v2, long int left, long int right)
     sort2_double(v, v2, last+1, right);
 }
 
+long int partial_sort2_double(double *v, double *v2, long int *stack, long int top, long int k)
+/*    
+      FUNCTION:       continue the quicksort of one double array until the positions up to 
+                      k hold their final values; second array does the same sequence of swaps  
+      INPUT:          two arrays, stack of ranges still to be sorted, number of entries in 
+                      the stack, index k
+      OUTPUT:         number of entries left in the stack
+      (SIDE)EFFECTS:  elements of the two arrays are swapped; ranges still to be sorted are 
+                      kept in the stack as pairs (left, right) with the leftmost range on top
+      COMMENTS:       ranges are partitioned exactly as in sort2_double, so the sorted 
+                      positions are identical to the ones obtained by sort2_double
+ */
+{
+    long int i, left, right, last;
+
+    while ( top > 0 && stack[top-2] <= k ) {
+        left = stack[top-2];
+        right = stack[top-1];
+        top -= 2;
+        swap2_double(v, v2, left, (left + right)/2);
+        last = left;
+        for (i=left+1; i <= right; i++)
+            if (v[i] < v[left])
+                swap2_double(v, v2, ++last, i);
+        swap2_double(v, v2, left, last);
+        if (last + 1 < right) {
+            stack[top++] = last + 1;
+            stack[top++] = right;
+        }
+        if (left < last) {
+            stack[top++] = left;
+            stack[top++] = last;
+        }
+    }
+    return top;
+}
+
+void * workspace_malloc( size_t size )
+/*    
+      FUNCTION:       allocate memory for a packing or local search workspace
+      INPUT:          size of the memory block in bytes
+      OUTPUT:         pointer to the memory block, NULL if there is not enough memory
+      (SIDE)EFFECTS:  workspace_allocations is incremented
+      COMMENTS:       the workspaces of the local search are allocated by the threads that 
+                      use them, hence the counter is updated atomically
+ */
+{
+    __sync_fetch_and_add( &workspace_allocations, 1 );
+    return malloc( size );
+}
+
+void * workspace_calloc( size_t n, size_t size )
+/*    
+      FUNCTION:       allocate zero-initialized memory for a packing or local search workspace
+      INPUT:          number of elements and size of each element in bytes
+      OUTPUT:         pointer to the memory block, NULL if there is not enough memory
+      (SIDE)EFFECTS:  workspace_allocations is incremented
+ */
+{
+    __sync_fetch_and_add( &workspace_allocations, 1 );
+    return calloc( n, size );
+}
+
 double ran01( long *idum )
 /*    
       FUNCTION:       generate a random number that is uniformly distributed in [0,1]
@@ -392,6 +458,171 @@ long int random_number( long *idum )
     return *idum;
 }
 
+__thread struct rng_stream rng;
+
+static void philox_block( struct rng_stream *s )
+/*    
+      FUNCTION:       compute the random words of the block given by the counter of s
+      INPUT:          pointer to the stream
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the block of s is overwritten, the block number is incremented
+      ORIGIN:         Philox-4x32-10 of Salmon et al. (2011)
+ */
+{
+    unsigned int c0 = s->counter[0], c1 = s->counter[1];
+    unsigned int c2 = s->counter[2], c3 = s->counter[3];
+    unsigned int k0 = s->key[0], k1 = s->key[1];
+    unsigned long long p0, p1;
+    long int r;
+
+    for ( r = 0 ; r < PHILOX_ROUNDS ; r++ ) {
+        p0 = (unsigned long long) PHILOX_M0 * c0;
+        p1 = (unsigned long long) PHILOX_M1 * c2;
+        c0 = (unsigned int) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (unsigned int) p1;
+        c2 = (unsigned int) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (unsigned int) p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    s->block[0] = c0;
+    s->block[1] = c1;
+    s->block[2] = c2;
+    s->block[3] = c3;
+    s->counter[0]++;
+    s->used = 0;
+}
+
+void rng_init_stream( struct rng_stream *s, long int try_no, long int iter, long int stream )
+/*    
+      FUNCTION:       position s at the start of the random number stream identified by 
+                      the seed, the try, the iteration and the stream number
+      INPUT:          pointer to the stream, number of the try, iteration and stream number
+      OUTPUT:         none
+      COMMENTS:       the numbers drawn from a stream do not depend on the thread nor on 
+                      any other stream, which makes parallel runs reproducible
+ */
+{
+    s->key[0] = (unsigned int) seed;
+    s->key[1] = (unsigned int) ((unsigned long long) seed >> 32) ^ (unsigned int) try_no;
+    s->counter[0] = 0;
+    s->counter[1] = (unsigned int) iter;
+    s->counter[2] = (unsigned int) stream;
+    s->counter[3] = 0;
+    s->used = 4;
+}
+
+double rng_ran01( struct rng_stream *s )
+/*    
+      FUNCTION:       generate a random number that is uniformly distributed in (0,1)
+      INPUT:          pointer to the stream
+      OUTPUT:         random number uniformly distributed in (0,1)
+      (SIDE)EFFECTS:  the position in the stream is advanced
+ */
+{
+    if ( s->used == 4 )
+        philox_block( s );
+    return ((double) s->block[s->used++] + 0.5) * (1.0 / 4294967296.0);
+}
+
+void rng_fill_ran01( struct rng_stream *s, double *u, long int n )
+/*    
+      FUNCTION:       fill a vector with random numbers uniformly distributed in (0,1)
+      INPUT:          pointer to the stream, vector and its length
+      OUTPUT:         none
+      (SIDE)EFFECTS:  u holds the next n numbers of the stream
+ */
+{
+    long int i;
+
+    for ( i = 0 ; i < n ; i++ ) {
+        if ( s->used == 4 )
+            philox_block( s );
+        u[i] = ((double) s->block[s->used++] + 0.5) * (1.0 / 4294967296.0);
+    }
+}
+
+void init_pow_table( struct pow_table *t, double y, double max_ulps )
+/*    
+      FUNCTION:       prepare the computation of x^y for a fixed exponent y by table_pow
+      INPUT:          pointer to the table, exponent y and admissible error in units in 
+                      the last place
+      OUTPUT:         none
+      (SIDE)EFFECTS:  the tables for the mantissa and the exponent of x are filled; the 
+                      number of terms of the series is the smallest one whose error does not 
+                      exceed max_ulps on a sample of bases, 0 (use pow) if there is none
+ */
+{
+    static const int exponents[] = { -200, -30, -1, 0, 1, 30, 200 };
+    long int i, j, terms;
+    int      e;
+    double   center, x, exact, error, worst;
+
+    t->y = y;
+    t->coefficient[0] = 1.0;
+    for ( i = 1 ; i <= APPROX_POW_MAX_TERMS ; i++ )
+        t->coefficient[i] = t->coefficient[i-1] * (y - i + 1) / i;
+    for ( j = 0 ; j < POW_TABLE_SIZE ; j++ ) {
+        center = 1.0 + (j + 0.5) / POW_TABLE_SIZE;
+        t->mantissa_inv[j] = 1.0 / center;
+        t->mantissa_pow[j] = pow( center, y );
+    }
+    t->exponent_pow[0] = t->exponent_pow[2047] = 0.0;  /* subnormal, infinite and NaN x use pow */
+    for ( i = 1 ; i < 2047 ; i++ )
+        t->exponent_pow[i] = pow( ldexp( 1.0, i - 1023 ), y );
+
+    for ( terms = 1 ; terms <= APPROX_POW_MAX_TERMS ; terms++ ) {
+        t->terms = terms;
+        worst = 0.0;
+        for ( i = 0 ; i < 4096 ; i++ ) {
+            for ( j = 0 ; j < (long int) (sizeof(exponents) / sizeof(exponents[0])) ; j++ ) {
+                x = ldexp( 1.0 + (i + 0.5) / 4096.0, exponents[j] );
+                exact = pow( x, y );
+                if ( !isnormal( exact ) )
+                    continue;
+                frexp( exact, &e );
+                error = fabs( table_pow( t, x ) - exact ) / ldexp( 1.0, e - 53 );
+                worst = MAX(worst, error);
+            }
+        }
+        if ( worst <= max_ulps )
+            return;
+    }
+    t->terms = 0;
+}
+
+double table_pow( const struct pow_table *t, double x )
+/*    
+      FUNCTION:       approximate x^y for the exponent y of table t
+      INPUT:          pointer to the table and base x
+      OUTPUT:         x^y
+      COMMENTS:       x = m * 2^e with m in [1,2) and c the center of the table interval 
+                      of m, so that x^y = (2^e)^y * c^y * (1 + r)^y with r = m/c - 1 and 
+                      |r| < 2^-(POW_TABLE_BITS+1); the first two factors come from the 
+                      tables, the last one from its binomial series
+ */
+{
+    unsigned long long bits;
+    long int e, j, i;
+    double   m, r, sum;
+
+    memcpy( &bits, &x, sizeof(bits) );
+    e = (long int) (bits >> 52);   /* biased exponent, >= 2048 if x is negative */
+    if ( t->terms == 0 || e == 0 || e >= 2047 )
+        return pow( x, t->y );
+
+    j = (long int) ((bits >> (52 - POW_TABLE_BITS)) & (POW_TABLE_SIZE - 1));
+    bits = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+    memcpy( &m, &bits, sizeof(m) );
+    r = m * t->mantissa_inv[j] - 1.0;
+
+    sum = t->coefficient[t->terms];
+    for ( i = t->terms - 1 ; i >= 0 ; i-- )
+        sum = sum * r + t->coefficient[i];
+
+    return t->exponent_pow[e] * t->mantissa_pow[j] * sum;
+}
+
 long int ** generate_int_matrix( long int n, long int m)
 /*    
       FUNCTION:       malloc a matrix and return pointer to it
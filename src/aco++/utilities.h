@@ -75,8 +75,32 @@
 #define IR 2836
 #define MASK 123459876
 
+/* constants of the Philox-4x32-10 counter-based random number generator, see
+   Salmon et al., Parallel random numbers: as easy as 1, 2, 3, SC 2011 */
+
+#define PHILOX_M0     0xD2511F53U
+#define PHILOX_M1     0xCD9E8D57U
+#define PHILOX_W0     0x9E3779B9U
+#define PHILOX_W1     0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+#define APPROX_POW_MAX_TERMS 16   /* max. no. of terms of the binomial series in table_pow */
+#define POW_TABLE_BITS       8    /* no. of leading mantissa bits that index the tables of table_pow */
+#define POW_TABLE_SIZE       (1 << POW_TABLE_BITS)
+
 extern long int seed;
 
+struct rng_stream {
+    unsigned int key[2];       /* derived from the seed and the number of the try */
+    unsigned int counter[4];   /* block number, iteration, stream number and a zero word */
+    unsigned int block[4];     /* random words of the current block */
+    long int     used;         /* number of words of the current block already consumed */
+};
+
+extern __thread struct rng_stream rng;  /* random number stream of the calling thread */
+
+extern long int workspace_allocations;  /* number of heap allocations done for the packing and local search workspaces */
+
 double mean ( long int *values, long int max);
 
 double meanr ( double *values, long int max );
@@ -107,10 +131,35 @@ void sort2(long int *v, long int *v2, long int left, long int right);
 
 void sort2_double(double *v, double *v2, long int left, long int right);
 
+long int partial_sort2_double(double *v, double *v2, long int *stack, long int top, long int k);
+
+void * workspace_malloc ( size_t size );
+
+void * workspace_calloc ( size_t n, size_t size );
+
 double ran01 ( long *idum );
 
 long int random_number ( long *idum );
 
+void rng_init_stream ( struct rng_stream *s, long int try_no, long int iter, long int stream );
+
+double rng_ran01 ( struct rng_stream *s );
+
+void rng_fill_ran01 ( struct rng_stream *s, double *u, long int n );
+
+struct pow_table {
+    double   y;                                      /* exponent */
+    long int terms;                                  /* terms of the series, 0: use pow */
+    double   coefficient[APPROX_POW_MAX_TERMS + 1];  /* binomial coefficients of y */
+    double   mantissa_inv[POW_TABLE_SIZE];           /* 1 / c for the interval centers c */
+    double   mantissa_pow[POW_TABLE_SIZE];           /* c^y */
+    double   exponent_pow[2048];                     /* (2^e)^y for the biased exponents e */
+};
+
+void init_pow_table ( struct pow_table *t, double y, double max_ulps );
+
+double table_pow ( const struct pow_table *t, double x );
+
 long int** generate_int_matrix( long int n, long int m);
 
 double** generate_double_matrix( long int n, long int m);
\ No newline at end of file